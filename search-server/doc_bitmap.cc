@@ -0,0 +1,225 @@
+#include "doc_bitmap.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "memory_usage.h"
+
+constexpr size_t BITMAP_ARRAY_LIMIT = 4096ull;
+constexpr size_t BITMAP_WORD_COUNT = 65536ull / 64ull;
+
+static uint32_t HighBits(int document_id) {
+  return static_cast<uint32_t>(document_id) >> 16;
+}
+
+static uint16_t LowBits(int document_id) {
+  return static_cast<uint16_t>(static_cast<uint32_t>(document_id) & 0xffff);
+}
+
+bool DocBitmap::Chunk::IsBitset() const { return !bits.empty(); }
+
+void DocBitmap::Chunk::Add(uint16_t low) {
+  if (IsBitset()) {
+    const uint64_t mask = 1ull << (low % 64);
+    if (!(bits[low / 64] & mask)) {
+      bits[low / 64] |= mask;
+      ++count;
+    }
+    return;
+  }
+  const auto it = std::lower_bound(array.begin(), array.end(), low);
+  if (it != array.end() && *it == low) {
+    return;
+  }
+  array.insert(it, low);
+  ++count;
+  if (array.size() > BITMAP_ARRAY_LIMIT) {
+    bits.assign(BITMAP_WORD_COUNT, 0);
+    for (const uint16_t value : array) {
+      bits[value / 64] |= 1ull << (value % 64);
+    }
+    array = {};
+  }
+}
+
+void DocBitmap::Chunk::Remove(uint16_t low) {
+  if (IsBitset()) {
+    const uint64_t mask = 1ull << (low % 64);
+    if (bits[low / 64] & mask) {
+      bits[low / 64] &= ~mask;
+      --count;
+    }
+    return;
+  }
+  const auto it = std::lower_bound(array.begin(), array.end(), low);
+  if (it != array.end() && *it == low) {
+    array.erase(it);
+    --count;
+  }
+}
+
+bool DocBitmap::Chunk::Contains(uint16_t low) const {
+  if (IsBitset()) {
+    return bits[low / 64] & (1ull << (low % 64));
+  }
+  return std::binary_search(array.begin(), array.end(), low);
+}
+
+std::vector<uint16_t> DocBitmap::Chunk::GetValues() const {
+  if (!IsBitset()) {
+    return array;
+  }
+  std::vector<uint16_t> values;
+  values.reserve(count);
+  for (size_t word = 0; word < bits.size(); ++word) {
+    for (uint64_t rest = bits[word]; rest != 0; rest &= rest - 1) {
+      const auto bit = static_cast<size_t>(__builtin_ctzll(rest));
+      values.push_back(static_cast<uint16_t>(word * 64 + bit));
+    }
+  }
+  return values;
+}
+
+void DocBitmap::Add(int document_id) {
+  chunks_[HighBits(document_id)].Add(LowBits(document_id));
+}
+
+void DocBitmap::Remove(int document_id) {
+  const auto it = chunks_.find(HighBits(document_id));
+  if (it == chunks_.end()) {
+    return;
+  }
+  it->second.Remove(LowBits(document_id));
+  if (it->second.count == 0) {
+    chunks_.erase(it);
+  }
+}
+
+bool DocBitmap::Contains(int document_id) const {
+  const auto it = chunks_.find(HighBits(document_id));
+  return it != chunks_.end() && it->second.Contains(LowBits(document_id));
+}
+
+size_t DocBitmap::GetMemoryUsage() const {
+  size_t bytes = chunks_.size() * NodeBytes<decltype(chunks_)>();
+  for (const auto& [_, chunk] : chunks_) {
+    bytes += BufferBytes(chunk.array) + BufferBytes(chunk.bits);
+  }
+  return bytes;
+}
+
+size_t DocBitmap::GetCount() const {
+  size_t count = 0;
+  for (const auto& [_, chunk] : chunks_) {
+    count += chunk.count;
+  }
+  return count;
+}
+
+bool DocBitmap::IsEmpty() const { return chunks_.empty(); }
+
+DocBitmap& DocBitmap::operator|=(const DocBitmap& other) {
+  for (const auto& [high, other_chunk] : other.chunks_) {
+    Chunk& chunk = chunks_[high];
+    if (chunk.IsBitset() && other_chunk.IsBitset()) {
+      chunk.count = 0;
+      for (size_t word = 0; word < BITMAP_WORD_COUNT; ++word) {
+        chunk.bits[word] |= other_chunk.bits[word];
+        chunk.count += std::bitset<64>(chunk.bits[word]).count();
+      }
+      continue;
+    }
+    for (const uint16_t low : other_chunk.GetValues()) {
+      chunk.Add(low);
+    }
+  }
+  return *this;
+}
+
+DocBitmap DocBitmap::Union(const std::vector<const DocBitmap*>& bitmaps) {
+  std::map<uint32_t, std::vector<const Chunk*>> high_to_chunks;
+  for (const DocBitmap* bitmap : bitmaps) {
+    for (const auto& [high, chunk] : bitmap->chunks_) {
+      high_to_chunks[high].push_back(&chunk);
+    }
+  }
+
+  DocBitmap result;
+  for (const auto& [high, chunks] : high_to_chunks) {
+    Chunk& chunk = result.chunks_[high];
+    size_t total_count = 0;
+    bool has_bitset = false;
+    for (const Chunk* part : chunks) {
+      total_count += part->count;
+      has_bitset = has_bitset || part->IsBitset();
+    }
+
+    if (!has_bitset && total_count <= BITMAP_ARRAY_LIMIT) {
+      chunk.array.reserve(total_count);
+      for (const Chunk* part : chunks) {
+        chunk.array.insert(chunk.array.end(), part->array.begin(),
+                           part->array.end());
+      }
+      std::sort(chunk.array.begin(), chunk.array.end());
+      chunk.array.erase(std::unique(chunk.array.begin(), chunk.array.end()),
+                        chunk.array.end());
+      chunk.count = chunk.array.size();
+      continue;
+    }
+
+    chunk.bits.assign(BITMAP_WORD_COUNT, 0);
+    for (const Chunk* part : chunks) {
+      if (part->IsBitset()) {
+        for (size_t word = 0; word < BITMAP_WORD_COUNT; ++word) {
+          chunk.bits[word] |= part->bits[word];
+        }
+      } else {
+        for (const uint16_t value : part->array) {
+          chunk.bits[value / 64] |= 1ull << (value % 64);
+        }
+      }
+    }
+    for (const uint64_t word : chunk.bits) {
+      chunk.count += std::bitset<64>(word).count();
+    }
+    // Overlapping inputs can leave few enough ids for an array
+    if (chunk.count <= BITMAP_ARRAY_LIMIT) {
+      chunk.array = chunk.GetValues();
+      chunk.bits = {};
+    }
+  }
+  return result;
+}
+
+DocBitmap& DocBitmap::operator&=(const DocBitmap& other) {
+  for (auto it = chunks_.begin(); it != chunks_.end();) {
+    const auto other_it = other.chunks_.find(it->first);
+    if (other_it == other.chunks_.end()) {
+      it = chunks_.erase(it);
+      continue;
+    }
+    Chunk& chunk = it->second;
+    const Chunk& other_chunk = other_it->second;
+    if (chunk.IsBitset() && other_chunk.IsBitset()) {
+      chunk.count = 0;
+      for (size_t word = 0; word < BITMAP_WORD_COUNT; ++word) {
+        chunk.bits[word] &= other_chunk.bits[word];
+        chunk.count += std::bitset<64>(chunk.bits[word]).count();
+      }
+    } else {
+      Chunk kept;
+      for (const uint16_t low : chunk.GetValues()) {
+        if (other_chunk.Contains(low)) {
+          kept.Add(low);
+        }
+      }
+      chunk = std::move(kept);
+    }
+    it = chunk.count == 0 ? chunks_.erase(it) : std::next(it);
+  }
+  return *this;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Roaring-style set of document ids. Ids are split by their high 16 bits
+// into chunks; a chunk is a sorted array of low halves while it is sparse
+// and turns into a 65536-bit bitset once it holds more than
+// BITMAP_ARRAY_LIMIT ids.
+class DocBitmap {
+ public:
+  void Add(int document_id);
+  void Remove(int document_id);
+  bool Contains(int document_id) const;
+
+  size_t GetCount() const;
+  bool IsEmpty() const;
+  // Heap bytes held by the chunks, map nodes included
+  size_t GetMemoryUsage() const;
+
+  DocBitmap& operator|=(const DocBitmap& other);
+  DocBitmap& operator&=(const DocBitmap& other);
+
+  // Builds each chunk of the result once, instead of growing it through
+  // repeated |=: arrays are merged, and a chunk that would exceed
+  // BITMAP_ARRAY_LIMIT is ORed straight into a bitset
+  static DocBitmap Union(const std::vector<const DocBitmap*>& bitmaps);
+
+ private:
+  struct Chunk {
+    std::vector<uint16_t> array;
+    std::vector<uint64_t> bits;
+    size_t count = 0;
+
+    bool IsBitset() const;
+    void Add(uint16_t low);
+    void Remove(uint16_t low);
+    bool Contains(uint16_t low) const;
+    std::vector<uint16_t> GetValues() const;
+  };
+
+  std::map<uint32_t, Chunk> chunks_;
+};
@@ -0,0 +1,210 @@
+#include "durable_search_server.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <execution>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+static void WriteFileDurably(const std::string& path, const std::string& data) {
+  const std::string temp_path = path + ".tmp";
+  const int fd =
+      open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "open");
+  }
+  size_t written = 0;
+  while (written < data.size()) {
+    const ssize_t size = write(fd, data.data() + written, data.size() - written);
+    if (size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (size < 0) {
+      const int error = errno;
+      close(fd);
+      throw std::system_error(error, std::generic_category(), "write");
+    }
+    written += static_cast<size_t>(size);
+  }
+  if (fsync(fd) < 0) {
+    const int error = errno;
+    close(fd);
+    throw std::system_error(error, std::generic_category(), "fsync");
+  }
+  close(fd);
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    throw std::system_error(errno, std::generic_category(), "rename");
+  }
+  // The rename itself must reach the disk before the log is emptied
+  const size_t slash = path.rfind('/');
+  const std::string directory =
+      slash == std::string::npos ? "." : path.substr(0, slash + 1);
+  const int directory_fd = open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+  if (directory_fd >= 0) {
+    fsync(directory_fd);
+    close(directory_fd);
+  }
+}
+
+DurableSearchServer::DurableSearchServer(
+    const std::string& stop_words, const std::string& log_path,
+    const std::string& checkpoint_path, std::chrono::microseconds commit_delay)
+    : search_server_(stop_words),
+      checkpoint_path_(checkpoint_path),
+      log_(log_path, commit_delay) {
+  std::vector<LogRecord> records = WriteAheadLog::ReadRecords(checkpoint_path_);
+  std::vector<LogRecord> log_records = log_.TakeRecoveredRecords();
+  records.insert(records.end(), std::make_move_iterator(log_records.begin()),
+                 std::make_move_iterator(log_records.end()));
+  Replay(records);
+}
+
+void DurableSearchServer::Replay(std::vector<LogRecord>& records) {
+  // Only the final state matters: documents added and later removed are
+  // never indexed, the rest go in once in their original order
+  std::map<int, size_t> live_records;
+  for (size_t i = 0; i < records.size(); ++i) {
+    if (records[i].type == LogRecord::Type::ADD) {
+      live_records[records[i].document_id] = i;
+    } else {
+      live_records.erase(records[i].document_id);
+    }
+  }
+  std::vector<size_t> order;
+  order.reserve(live_records.size());
+  for (const auto& [_, index] : live_records) {
+    order.push_back(index);
+  }
+  std::sort(order.begin(), order.end());
+
+  // Bulk path: texts are split on all cores, then indexed in log order
+  std::vector<TokenizedDocument> documents;
+  documents.reserve(order.size());
+  for (const size_t index : order) {
+    LogRecord& record = records[index];
+    documents.push_back({record.document_id, record.status,
+                         std::move(record.ratings), std::move(record.text),
+                         {}});
+  }
+  std::for_each(std::execution::par, documents.begin(), documents.end(),
+                [this](TokenizedDocument& document) {
+                  search_server_.Tokenize(document);
+                });
+  for (TokenizedDocument& document : documents) {
+    search_server_.AddDocument(std::move(document));
+  }
+}
+
+void DurableSearchServer::WaitDurable(uint64_t sequence_number,
+                                      int document_id) {
+  try {
+    log_.WaitDurable(sequence_number);
+  } catch (...) {
+    std::unique_lock lock(mutex_);
+    pending_ids_.erase(document_id);
+    is_applied_.notify_all();
+    throw;
+  }
+}
+
+void DurableSearchServer::AddDocument(int document_id,
+                                      std::string_view document,
+                                      DocumentStatus status,
+                                      const std::vector<int>& ratings) {
+  using namespace std::literals;
+  // Invalid documents throw before anything reaches the log. Splitting the
+  // text needs no lock, so writers queue only for the checks and indexing.
+  TokenizedDocument tokenized{document_id, status, ratings,
+                              std::string(document), {}};
+  search_server_.Tokenize(tokenized);
+  uint64_t sequence_number;
+  {
+    std::unique_lock lock(mutex_);
+    search_server_.CheckNewDocumentId(document_id);
+    if (pending_ids_.count(document_id) != 0) {
+      throw std::invalid_argument("ADD_DOC_SAME_ID"s);
+    }
+    sequence_number = log_.Append(LogRecord{LogRecord::Type::ADD, document_id,
+                                            status, ratings,
+                                            std::string(document)});
+    pending_ids_.insert(document_id);
+  }
+  WaitDurable(sequence_number, document_id);
+  std::unique_lock lock(mutex_);
+  search_server_.AddDocument(std::move(tokenized));
+  pending_ids_.erase(document_id);
+  is_applied_.notify_all();
+}
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+  uint64_t sequence_number;
+  {
+    std::unique_lock lock(mutex_);
+    // A document still being added is not there yet
+    if (!search_server_.ContainsDocument(document_id) ||
+        pending_ids_.count(document_id) != 0) {
+      return;
+    }
+    sequence_number =
+        log_.Append(LogRecord{LogRecord::Type::REMOVE, document_id,
+                              DocumentStatus::ACTUAL, {}, {}});
+    pending_ids_.insert(document_id);
+  }
+  WaitDurable(sequence_number, document_id);
+  std::unique_lock lock(mutex_);
+  search_server_.RemoveDocuments({document_id});
+  pending_ids_.erase(document_id);
+  is_applied_.notify_all();
+}
+
+void DurableSearchServer::Checkpoint() {
+  std::unique_lock lock(mutex_);
+  // A change already logged but not applied would be in neither the
+  // checkpoint nor the emptied log
+  is_applied_.wait(lock, [this] { return pending_ids_.empty(); });
+  std::string data;
+  for (const int document_id : search_server_) {
+    const auto [text, status, rating] = search_server_.GetDocument(document_id);
+    // The average of a single rating is the rating itself
+    AppendLogRecord(data, LogRecord{LogRecord::Type::ADD, document_id, status,
+                                    {rating}, std::string(text)});
+  }
+  WriteFileDurably(checkpoint_path_, data);
+  log_.Truncate();
+}
+
+std::vector<Document> DurableSearchServer::FindTopDocuments(
+    std::string_view raw_query, DocumentStatus status) const {
+  std::shared_lock lock(mutex_);
+  return search_server_.FindTopDocuments(raw_query, status);
+}
+
+std::vector<Document> DurableSearchServer::FindTopDocuments(
+    std::string_view raw_query) const {
+  return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+size_t DurableSearchServer::GetDocumentCount() const {
+  std::shared_lock lock(mutex_);
+  return search_server_.GetDocumentCount();
+}
+
+size_t DurableSearchServer::GetSyncCount() const { return log_.GetSyncCount(); }
+
+const SearchServer& DurableSearchServer::GetSearchServer() const {
+  return search_server_;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+// SearchServer whose mutations survive a crash. Every change is validated,
+// appended to a write-ahead log and applied in memory only once the log is
+// synced, so readers never see a change that a crash could undo.
+// Concurrent writers are committed together. A checkpoint writes all live
+// documents to a separate file and empties the log.
+class DurableSearchServer {
+ public:
+  // Rebuilds the index from the checkpoint and the log. Stop words are not
+  // logged and must be the same on every start.
+  DurableSearchServer(
+      const std::string& stop_words, const std::string& log_path,
+      const std::string& checkpoint_path,
+      std::chrono::microseconds commit_delay = std::chrono::microseconds{0});
+
+  void AddDocument(int document_id, std::string_view document,
+                   DocumentStatus status, const std::vector<int>& ratings);
+  void RemoveDocument(int document_id);
+
+  void Checkpoint();
+
+  std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                         DocumentStatus status) const;
+  std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+  size_t GetDocumentCount() const;
+  size_t GetSyncCount() const;
+
+  // Not synchronised with concurrent writers
+  const SearchServer& GetSearchServer() const;
+
+ private:
+  SearchServer search_server_;
+  const std::string checkpoint_path_;
+  mutable std::shared_mutex mutex_;
+  // Documents with a change in the log but not yet in memory; another
+  // change to them is refused until it lands. Guarded by mutex_.
+  std::set<int> pending_ids_;
+  std::condition_variable_any is_applied_;
+  WriteAheadLog log_;
+
+  void Replay(std::vector<LogRecord>& records);
+  // Waits for the record; if the log failed, drops the document's pending
+  // change and rethrows, so the change is never applied
+  void WaitDurable(uint64_t sequence_number, int document_id);
+};
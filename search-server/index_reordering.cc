@@ -0,0 +1,176 @@
+#include "index_reordering.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Estimated bits per posting of a word held by degree of size documents
+double GetGapCost(int degree, size_t size) {
+  if (degree == 0) {
+    return 0.0;
+  }
+  return degree * std::log2(static_cast<double>(size) / (degree + 1));
+}
+
+class Bisection {
+ public:
+  Bisection(std::vector<std::vector<uint32_t>> document_terms,
+            size_t term_count, int iterations)
+      : document_terms_(std::move(document_terms)),
+        iterations_(iterations),
+        left_degrees_(term_count),
+        right_degrees_(term_count),
+        left_gains_(term_count),
+        right_gains_(term_count),
+        stamps_(term_count) {
+    order_.resize(document_terms_.size());
+    for (uint32_t i = 0; i < order_.size(); ++i) {
+      order_[i] = i;
+    }
+  }
+
+  std::vector<uint32_t> Run() {
+    Split(0, order_.size());
+    return std::move(order_);
+  }
+
+ private:
+  std::vector<std::vector<uint32_t>> document_terms_;
+  int iterations_;
+  std::vector<uint32_t> order_;
+  std::vector<int> left_degrees_;
+  std::vector<int> right_degrees_;
+  // Lowered cost when a document holding the word leaves that half
+  std::vector<double> left_gains_;
+  std::vector<double> right_gains_;
+  // Words seen in the current iteration carry its stamp
+  std::vector<uint32_t> stamps_;
+  uint32_t stamp_ = 0;
+  std::vector<uint32_t> touched_terms_;
+  std::vector<std::pair<double, uint32_t>> left_moves_;
+  std::vector<std::pair<double, uint32_t>> right_moves_;
+
+  void Split(size_t begin, size_t end) {
+    if (end - begin <= BISECTION_LEAF_SIZE) {
+      return;
+    }
+    const size_t middle = begin + (end - begin) / 2;
+    for (int iteration = 0; iteration < iterations_; ++iteration) {
+      if (!Improve(begin, middle, end)) {
+        break;
+      }
+    }
+    Split(begin, middle);
+    Split(middle, end);
+  }
+
+  // Swaps the pairs of documents whose exchange lowers the cost; false
+  // when there is none
+  bool Improve(size_t begin, size_t middle, size_t end) {
+    ++stamp_;
+    touched_terms_.clear();
+    for (size_t i = begin; i < end; ++i) {
+      const bool is_left = i < middle;
+      for (const uint32_t term : document_terms_[order_[i]]) {
+        if (stamps_[term] != stamp_) {
+          stamps_[term] = stamp_;
+          left_degrees_[term] = 0;
+          right_degrees_[term] = 0;
+          touched_terms_.push_back(term);
+        }
+        ++(is_left ? left_degrees_ : right_degrees_)[term];
+      }
+    }
+
+    const size_t left_size = middle - begin;
+    const size_t right_size = end - middle;
+    for (const uint32_t term : touched_terms_) {
+      const int left = left_degrees_[term];
+      const int right = right_degrees_[term];
+      const double cost =
+          GetGapCost(left, left_size) + GetGapCost(right, right_size);
+      left_gains_[term] = cost - GetGapCost(left - 1, left_size) -
+                          GetGapCost(right + 1, right_size);
+      right_gains_[term] = cost - GetGapCost(left + 1, left_size) -
+                           GetGapCost(right - 1, right_size);
+    }
+
+    const auto collect_moves = [this](size_t from, size_t to,
+                                      const std::vector<double>& term_gains,
+                                      auto& moves) {
+      moves.clear();
+      for (size_t i = from; i < to; ++i) {
+        double gain = 0.0;
+        for (const uint32_t term : document_terms_[order_[i]]) {
+          gain += term_gains[term];
+        }
+        moves.emplace_back(gain, order_[i]);
+      }
+      std::sort(moves.begin(), moves.end(), std::greater<>());
+    };
+    collect_moves(begin, middle, left_gains_, left_moves_);
+    collect_moves(middle, end, right_gains_, right_moves_);
+
+    size_t swaps = 0;
+    while (swaps < left_moves_.size() && swaps < right_moves_.size() &&
+           left_moves_[swaps].first + right_moves_[swaps].first > 0.0) {
+      std::swap(left_moves_[swaps].second, right_moves_[swaps].second);
+      ++swaps;
+    }
+    for (size_t i = 0; i < left_moves_.size(); ++i) {
+      order_[begin + i] = left_moves_[i].second;
+    }
+    for (size_t i = 0; i < right_moves_.size(); ++i) {
+      order_[middle + i] = right_moves_[i].second;
+    }
+    return swaps > 0;
+  }
+};
+
+}  // namespace
+
+std::vector<int> ComputeBisectionOrder(const SearchServer& search_server,
+                                       int iterations) {
+  std::vector<int> document_ids(search_server.begin(), search_server.end());
+
+  std::unordered_map<std::string_view, uint32_t> document_counts;
+  for (const int document_id : document_ids) {
+    for (const auto& [word, _] : search_server.GetWordFrequencies(document_id)) {
+      ++document_counts[word];
+    }
+  }
+  std::unordered_map<std::string_view, uint32_t> term_indexes;
+  for (const auto& [word, count] : document_counts) {
+    if (count > 1) {
+      term_indexes.emplace(word, static_cast<uint32_t>(term_indexes.size()));
+    }
+  }
+
+  std::vector<std::vector<uint32_t>> document_terms(document_ids.size());
+  for (size_t i = 0; i < document_ids.size(); ++i) {
+    for (const auto& [word, _] :
+         search_server.GetWordFrequencies(document_ids[i])) {
+      const auto it = term_indexes.find(word);
+      if (it != term_indexes.end()) {
+        document_terms[i].push_back(it->second);
+      }
+    }
+  }
+
+  const std::vector<uint32_t> order =
+      Bisection(std::move(document_terms), term_indexes.size(), iterations)
+          .Run();
+  std::vector<int> ordered_ids;
+  ordered_ids.reserve(order.size());
+  for (const uint32_t index : order) {
+    ordered_ids.push_back(document_ids[index]);
+  }
+  return ordered_ids;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+
+#include "search_server.h"
+
+constexpr int BISECTION_ITERATIONS = 20;
+// Parts this small are left in their current order
+constexpr size_t BISECTION_LEAF_SIZE = 16ull;
+
+// Order of the documents found by recursive graph bisection: each part is
+// split in two and documents are swapped between the halves while that
+// lowers the estimated log-gap cost of the words they share. Words that
+// occur in a single document cannot change the cost and are ignored.
+// Pass the result to SearchServer::ReorderDocuments.
+std::vector<int> ComputeBisectionOrder(const SearchServer& search_server,
+                                       int iterations = BISECTION_ITERATIONS);
@@ -0,0 +1,529 @@
+#include "ingestion_pipeline.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "spsc_queue.h"
+
+namespace {
+
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "open");
+    }
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) < 0) {
+      const int error = errno;
+      close(fd);
+      throw std::system_error(error, std::generic_category(), "fstat");
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0) {
+      data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data_ == MAP_FAILED) {
+        const int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "mmap");
+      }
+      madvise(data_, size_, MADV_SEQUENTIAL);
+    }
+    close(fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (size_ > 0) {
+      munmap(data_, size_);
+    }
+  }
+
+  std::string_view GetData() const {
+    return {static_cast<const char*>(data_), size_};
+  }
+
+ private:
+  void* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+std::optional<DocumentStatus> ParseStatus(std::string_view text) {
+  using namespace std::literals;
+  if (text == "ACTUAL"sv || text == "0"sv) {
+    return DocumentStatus::ACTUAL;
+  }
+  if (text == "IRRELEVANT"sv || text == "1"sv) {
+    return DocumentStatus::IRRELEVANT;
+  }
+  if (text == "BANNED"sv || text == "2"sv) {
+    return DocumentStatus::BANNED;
+  }
+  if (text == "REMOVED"sv || text == "3"sv) {
+    return DocumentStatus::REMOVED;
+  }
+  return std::nullopt;
+}
+
+bool ParseInt(std::string_view text, int& value) {
+  const char* end = text.data() + text.size();
+  const auto [ptr, error] = std::from_chars(text.data(), end, value);
+  return error == std::errc() && ptr == end;
+}
+
+bool ParseTsvLine(std::string_view line, TokenizedDocument& document) {
+  std::string_view fields[3];
+  for (std::string_view& field : fields) {
+    const size_t tab = line.find('\t');
+    if (tab == std::string_view::npos) {
+      return false;
+    }
+    field = line.substr(0, tab);
+    line.remove_prefix(tab + 1);
+  }
+
+  const std::optional<DocumentStatus> status = ParseStatus(fields[1]);
+  if (!ParseInt(fields[0], document.id) || !status) {
+    return false;
+  }
+  document.status = *status;
+
+  document.ratings.clear();
+  std::string_view ratings = fields[2];
+  while (!ratings.empty()) {
+    const size_t end = ratings.find_first_of(" ,");
+    const std::string_view rating = ratings.substr(0, end);
+    if (!rating.empty()) {
+      int value;
+      if (!ParseInt(rating, value)) {
+        return false;
+      }
+      document.ratings.push_back(value);
+    }
+    ratings.remove_prefix(end == std::string_view::npos ? ratings.size()
+                                                        : end + 1);
+  }
+
+  document.text.assign(line.data(), line.size());
+  return true;
+}
+
+// Just enough JSON for one flat object per line
+class JsonLineParser {
+ public:
+  explicit JsonLineParser(std::string_view line) : line_(line) {}
+
+  bool Parse(TokenizedDocument& document) {
+    using namespace std::literals;
+    bool has_id = false;
+    bool has_text = false;
+    document.status = DocumentStatus::ACTUAL;
+    document.ratings.clear();
+    if (!Consume('{')) {
+      return false;
+    }
+    if (Consume('}')) {
+      return false;
+    }
+    std::string key;
+    do {
+      if (!ParseString(key) || !Consume(':')) {
+        return false;
+      }
+      SkipSpaces();
+      if (key == "id"sv) {
+        has_id = ParseNumber(document.id);
+        if (!has_id) {
+          return false;
+        }
+      } else if (key == "status"sv) {
+        if (!ParseStatusValue(document.status)) {
+          return false;
+        }
+      } else if (key == "ratings"sv) {
+        if (!ParseIntArray(document.ratings)) {
+          return false;
+        }
+      } else if (key == "text"sv) {
+        has_text = ParseString(document.text);
+        if (!has_text) {
+          return false;
+        }
+      } else if (!SkipValue()) {
+        return false;
+      }
+    } while (Consume(','));
+    if (!Consume('}')) {
+      return false;
+    }
+    SkipSpaces();
+    return has_id && has_text && pos_ == line_.size();
+  }
+
+ private:
+  std::string_view line_;
+  size_t pos_ = 0;
+
+  void SkipSpaces() {
+    while (pos_ < line_.size() &&
+           (line_[pos_] == ' ' || line_[pos_] == '\t')) {
+      ++pos_;
+    }
+  }
+
+  bool Consume(char c) {
+    SkipSpaces();
+    if (pos_ < line_.size() && line_[pos_] == c) {
+      ++pos_;
+      return true;
+    }
+    return false;
+  }
+
+  bool ParseNumber(int& value) {
+    SkipSpaces();
+    const size_t begin = pos_;
+    while (pos_ < line_.size() &&
+           (line_[pos_] == '-' || (line_[pos_] >= '0' && line_[pos_] <= '9'))) {
+      ++pos_;
+    }
+    return ParseInt(line_.substr(begin, pos_ - begin), value);
+  }
+
+  bool ParseStatusValue(DocumentStatus& status) {
+    std::optional<DocumentStatus> parsed;
+    if (pos_ < line_.size() && line_[pos_] == '"') {
+      std::string name;
+      if (!ParseString(name)) {
+        return false;
+      }
+      parsed = ParseStatus(name);
+    } else {
+      const size_t begin = pos_;
+      int number;
+      if (!ParseNumber(number)) {
+        return false;
+      }
+      parsed = ParseStatus(line_.substr(begin, pos_ - begin));
+    }
+    if (parsed) {
+      status = *parsed;
+    }
+    return parsed.has_value();
+  }
+
+  bool ParseIntArray(std::vector<int>& values) {
+    if (!Consume('[')) {
+      return false;
+    }
+    if (Consume(']')) {
+      return true;
+    }
+    do {
+      int value;
+      if (!ParseNumber(value)) {
+        return false;
+      }
+      values.push_back(value);
+    } while (Consume(','));
+    return Consume(']');
+  }
+
+  // Decodes straight into out, which is where the text is stored later
+  bool ParseString(std::string& out) {
+    out.clear();
+    if (!Consume('"')) {
+      return false;
+    }
+    while (pos_ < line_.size()) {
+      const size_t end = line_.find_first_of("\"\\", pos_);
+      if (end == std::string_view::npos) {
+        return false;
+      }
+      out.append(line_.data() + pos_, end - pos_);
+      pos_ = end + 1;
+      if (line_[end] == '"') {
+        return true;
+      }
+      if (pos_ == line_.size() || !AppendEscape(out)) {
+        return false;
+      }
+    }
+    return false;
+  }
+
+  bool AppendEscape(std::string& out) {
+    const char c = line_[pos_++];
+    switch (c) {
+      case '"':
+      case '\\':
+      case '/':
+        out.push_back(c);
+        return true;
+      case 'b':
+        out.push_back('\b');
+        return true;
+      case 'f':
+        out.push_back('\f');
+        return true;
+      case 'n':
+        out.push_back('\n');
+        return true;
+      case 'r':
+        out.push_back('\r');
+        return true;
+      case 't':
+        out.push_back('\t');
+        return true;
+      case 'u':
+        return AppendCodePoint(out);
+      default:
+        return false;
+    }
+  }
+
+  bool ParseHex4(uint32_t& value) {
+    if (line_.size() - pos_ < 4) {
+      return false;
+    }
+    const char* begin = line_.data() + pos_;
+    const auto [ptr, error] = std::from_chars(begin, begin + 4, value, 16);
+    pos_ += 4;
+    return error == std::errc() && ptr == begin + 4;
+  }
+
+  bool AppendCodePoint(std::string& out) {
+    uint32_t code_point;
+    if (!ParseHex4(code_point)) {
+      return false;
+    }
+    if (code_point >= 0xd800 && code_point < 0xdc00) {
+      uint32_t low;
+      if (line_.substr(pos_, 2) != "\\u" || (pos_ += 2, !ParseHex4(low)) ||
+          low < 0xdc00 || low >= 0xe000) {
+        return false;
+      }
+      code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+    }
+    if (code_point < 0x80) {
+      out.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+      out.push_back(static_cast<char>(0xc0 | (code_point >> 6)));
+      out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    } else if (code_point < 0x10000) {
+      out.push_back(static_cast<char>(0xe0 | (code_point >> 12)));
+      out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+      out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    } else {
+      out.push_back(static_cast<char>(0xf0 | (code_point >> 18)));
+      out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3f)));
+      out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+      out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    }
+    return true;
+  }
+
+  // Unknown fields: scalars, or nested arrays and objects
+  bool SkipValue() {
+    std::string scratch;
+    int depth = 0;
+    do {
+      SkipSpaces();
+      if (pos_ == line_.size()) {
+        return false;
+      }
+      const char c = line_[pos_];
+      if (c == '"') {
+        if (!ParseString(scratch)) {
+          return false;
+        }
+      } else if (c == '[' || c == '{') {
+        ++depth;
+        ++pos_;
+      } else if (c == ']' || c == '}') {
+        if (depth == 0) {
+          return false;
+        }
+        --depth;
+        ++pos_;
+      } else if (c == ',' || c == ':') {
+        if (depth == 0) {
+          return false;
+        }
+        ++pos_;
+      } else {
+        const size_t end = line_.find_first_of(",:]} \t", pos_);
+        pos_ = end == std::string_view::npos ? line_.size() : end;
+      }
+    } while (depth > 0);
+    return true;
+  }
+};
+
+using Clock = std::chrono::steady_clock;
+
+double ToSeconds(Clock::duration duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+
+template <typename Callback>
+void ForEachLine(std::string_view data, Callback callback) {
+  while (!data.empty()) {
+    const size_t end = data.find('\n');
+    std::string_view line = data.substr(0, end);
+    data.remove_prefix(end == std::string_view::npos ? data.size() : end + 1);
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    if (!line.empty() && !callback(line)) {
+      return;
+    }
+  }
+}
+
+}  // namespace
+
+double IngestionStats::GetMegabytesPerSecond() const {
+  return seconds > 0.0 ? static_cast<double>(bytes) / 1e6 / seconds : 0.0;
+}
+
+double IngestionStats::GetDocumentsPerSecond() const {
+  return seconds > 0.0 ? static_cast<double>(indexed_documents) / seconds
+                       : 0.0;
+}
+
+CorpusFormat DetectCorpusFormat(const std::string& path) {
+  using namespace std::literals;
+  const size_t dot = path.rfind('.');
+  if (dot != std::string::npos) {
+    const std::string_view extension = std::string_view(path).substr(dot);
+    if (extension == ".jsonl"sv || extension == ".json"sv) {
+      return CorpusFormat::JSONL;
+    }
+  }
+  return CorpusFormat::TSV;
+}
+
+bool ParseCorpusLine(std::string_view line, CorpusFormat format,
+                     TokenizedDocument& document) {
+  document.words.clear();
+  if (format == CorpusFormat::JSONL) {
+    return JsonLineParser(line).Parse(document);
+  }
+  return ParseTsvLine(line, document);
+}
+
+IngestionStats IngestCorpus(SearchServer& search_server,
+                            const std::string& path, CorpusFormat format,
+                            size_t queue_capacity) {
+  const auto start = Clock::now();
+  const MappedFile file(path);
+  SpscQueue<TokenizedDocument> parsed(queue_capacity);
+  SpscQueue<TokenizedDocument> tokenized(queue_capacity);
+  IngestionStats stats;
+  stats.bytes = file.GetData().size();
+
+  size_t malformed_lines = 0;
+  Clock::duration parse_time{};
+  std::exception_ptr parse_error;
+  std::thread parser([&] {
+    try {
+      ForEachLine(file.GetData(), [&](std::string_view line) {
+        const auto parse_start = Clock::now();
+        TokenizedDocument document;
+        const bool is_parsed = ParseCorpusLine(line, format, document);
+        parse_time += Clock::now() - parse_start;
+        if (!is_parsed) {
+          ++malformed_lines;
+          return true;
+        }
+        return parsed.Push(std::move(document));
+      });
+    } catch (...) {
+      parse_error = std::current_exception();
+    }
+    parsed.Close();
+  });
+
+  size_t invalid_documents = 0;
+  Clock::duration tokenize_time{};
+  std::exception_ptr tokenize_error;
+  std::thread tokenizer([&] {
+    try {
+      while (std::optional<TokenizedDocument> document = parsed.Pop()) {
+        const auto tokenize_start = Clock::now();
+        try {
+          search_server.Tokenize(*document);
+        } catch (const std::invalid_argument&) {
+          ++invalid_documents;
+          continue;
+        }
+        tokenize_time += Clock::now() - tokenize_start;
+        if (!tokenized.Push(std::move(*document))) {
+          break;
+        }
+      }
+    } catch (...) {
+      tokenize_error = std::current_exception();
+    }
+    // Stops the parser too if this stage quits early
+    parsed.Close();
+    tokenized.Close();
+  });
+
+  Clock::duration index_time{};
+  std::exception_ptr index_error;
+  try {
+    while (std::optional<TokenizedDocument> document = tokenized.Pop()) {
+      const auto index_start = Clock::now();
+      try {
+        search_server.AddDocument(std::move(*document));
+        ++stats.indexed_documents;
+      } catch (const std::invalid_argument&) {
+        ++stats.rejected_documents;
+      }
+      index_time += Clock::now() - index_start;
+    }
+  } catch (...) {
+    index_error = std::current_exception();
+    tokenized.Close();
+    parsed.Close();
+  }
+  parser.join();
+  tokenizer.join();
+  for (const std::exception_ptr& error :
+       {index_error, parse_error, tokenize_error}) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  stats.malformed_lines = malformed_lines;
+  stats.rejected_documents += invalid_documents;
+  stats.parse_stalls = parsed.GetFullWaitCount();
+  stats.tokenize_stalls = tokenized.GetFullWaitCount();
+  stats.parse_seconds = ToSeconds(parse_time);
+  stats.tokenize_seconds = ToSeconds(tokenize_time);
+  stats.index_seconds = ToSeconds(index_time);
+  stats.seconds = ToSeconds(Clock::now() - start);
+  return stats;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "search_server.h"
+
+constexpr size_t INGESTION_QUEUE_CAPACITY = 1024ull;
+
+enum class CorpusFormat {
+  // id <TAB> status <TAB> ratings <TAB> text, ratings separated by spaces
+  TSV,
+  // {"id": 1, "status": "ACTUAL", "ratings": [1, 2], "text": "..."}
+  JSONL,
+};
+
+struct IngestionStats {
+  size_t bytes = 0;
+  size_t indexed_documents = 0;
+  size_t malformed_lines = 0;
+  // Invalid symbols, negative or repeated id
+  size_t rejected_documents = 0;
+  // Times a stage found the queue to the next one full
+  size_t parse_stalls = 0;
+  size_t tokenize_stalls = 0;
+  // Time each stage spent working rather than waiting on a queue; the
+  // largest one bounds the throughput
+  double parse_seconds = 0.0;
+  double tokenize_seconds = 0.0;
+  double index_seconds = 0.0;
+  double seconds = 0.0;
+
+  double GetMegabytesPerSecond() const;
+  double GetDocumentsPerSecond() const;
+};
+
+// .jsonl and .json files are JSONL, anything else is TSV
+CorpusFormat DetectCorpusFormat(const std::string& path);
+
+// Status is a DocumentStatus name or number. Leaves words empty.
+// Returns false for a malformed line.
+bool ParseCorpusLine(std::string_view line, CorpusFormat format,
+                     TokenizedDocument& document);
+
+// Maps the file and runs parsing, tokenizing and indexing as three stages
+// connected by bounded queues; the calling thread does the indexing.
+// Each text is copied once, from the mapping into the document it ends
+// up stored in. Malformed lines and rejected documents are counted and
+// skipped.
+IngestionStats IngestCorpus(SearchServer& search_server,
+                            const std::string& path, CorpusFormat format,
+                            size_t queue_capacity = INGESTION_QUEUE_CAPACITY);
@@ -0,0 +1,49 @@
+#include "latency_stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ostream>
+#include <string>
+
+void LatencyStats::Add(std::chrono::nanoseconds latency) {
+  samples_.push_back(latency.count());
+  is_sorted_ = false;
+}
+
+void LatencyStats::Merge(const LatencyStats& other) {
+  samples_.insert(samples_.end(), other.samples_.cbegin(),
+                  other.samples_.cend());
+  is_sorted_ = false;
+}
+
+size_t LatencyStats::GetCount() const { return samples_.size(); }
+
+std::chrono::nanoseconds LatencyStats::GetPercentile(double p) const {
+  if (samples_.empty()) {
+    return std::chrono::nanoseconds{0};
+  }
+  if (!is_sorted_) {
+    std::sort(samples_.begin(), samples_.end());
+    is_sorted_ = true;
+  }
+  const auto rank = static_cast<size_t>(
+      std::ceil(std::clamp(p, 0.0, 1.0) * samples_.size()));
+  return std::chrono::nanoseconds{samples_[rank == 0 ? 0 : rank - 1]};
+}
+
+void LatencyStats::Report(std::ostream& os,
+                          std::chrono::nanoseconds elapsed) const {
+  using namespace std::literals;
+  const auto us = [this](double p) {
+    return std::chrono::duration<double, std::micro>(GetPercentile(p)).count();
+  };
+  const double seconds = std::chrono::duration<double>(elapsed).count();
+  os << GetCount() << " requests, "s
+     << (seconds > 0 ? GetCount() / seconds : 0.0) << " req/s, "s
+     << "p50 = "s << us(0.5) << " us, "s
+     << "p90 = "s << us(0.9) << " us, "s
+     << "p99 = "s << us(0.99) << " us, "s
+     << "p99.9 = "s << us(0.999) << " us, "s
+     << "max = "s << us(1.0) << " us"s << std::endl;
+}
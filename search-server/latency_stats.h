@@ -0,0 +1,24 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Collects latency samples and reports throughput and percentiles
+class LatencyStats {
+ public:
+  void Add(std::chrono::nanoseconds latency);
+  void Merge(const LatencyStats& other);
+
+  size_t GetCount() const;
+  // p in [0, 1]; zero when there are no samples
+  std::chrono::nanoseconds GetPercentile(double p) const;
+
+  // "<count> requests, <rate> req/s, p50 ... p99.9 ... max ..."
+  void Report(std::ostream& os, std::chrono::nanoseconds elapsed) const;
+
+ private:
+  mutable std::vector<int64_t> samples_;
+  mutable bool is_sorted_ = true;
+};
@@ -0,0 +1,189 @@
+#include "levenshtein_automaton.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+LevenshteinAutomaton::LevenshteinAutomaton(std::string_view word,
+                                           int max_edits)
+    : max_edits_(static_cast<uint8_t>(std::clamp(max_edits, 0, 254))) {
+  for (size_t pos = 0; pos < word.size();) {
+    word_.push_back(DecodeUtf8(word, pos));
+  }
+  alphabet_ = word_;
+  std::sort(alphabet_.begin(), alphabet_.end());
+  alphabet_.erase(std::unique(alphabet_.begin(), alphabet_.end()),
+                  alphabet_.end());
+}
+
+LevenshteinAutomaton::State LevenshteinAutomaton::Start() const {
+  // Distances above max_edits are all the same to the caller, so the row
+  // saturates at max_edits + 1 and fits in a byte
+  State state(word_.size() + 1);
+  for (size_t i = 0; i < state.size(); ++i) {
+    state[i] = static_cast<uint8_t>(std::min<size_t>(i, max_edits_ + 1u));
+  }
+  return state;
+}
+
+void LevenshteinAutomaton::Step(const State& from, char32_t c,
+                                State& to) const {
+  const uint8_t limit = max_edits_ + 1;
+  to[0] = std::min<uint8_t>(from[0] + 1, limit);
+  for (size_t i = 1; i < from.size(); ++i) {
+    const uint8_t substitution = from[i - 1] + (word_[i - 1] == c ? 0 : 1);
+    const uint8_t insertion = from[i] + 1;
+    const uint8_t deletion = to[i - 1] + 1;
+    to[i] = std::min({substitution, insertion, deletion, limit});
+  }
+}
+
+int LevenshteinAutomaton::GetDistance(const State& state) const {
+  return state.back();
+}
+
+bool LevenshteinAutomaton::IsMatch(const State& state) const {
+  return state.back() <= max_edits_;
+}
+
+bool LevenshteinAutomaton::CanMatch(const State& state) const {
+  return *std::min_element(state.begin(), state.end()) <= max_edits_;
+}
+
+std::optional<char32_t> LevenshteinAutomaton::GetNextViable(
+    const State& from, char32_t after, State& scratch) const {
+  // Matches no code point of the word
+  constexpr char32_t OTHER = 0xffffffff;
+  Step(from, OTHER, scratch);
+  if (CanMatch(scratch)) {
+    return after + 1;
+  }
+  for (auto it = std::upper_bound(alphabet_.begin(), alphabet_.end(), after);
+       it != alphabet_.end(); ++it) {
+    Step(from, *it, scratch);
+    if (CanMatch(scratch)) {
+      return *it;
+    }
+  }
+  return std::nullopt;
+}
+
+size_t LevenshteinAutomaton::GetSymbolCount() const {
+  return alphabet_.size() + 1;
+}
+
+size_t LevenshteinAutomaton::GetSymbol(char32_t c) const {
+  const auto it = std::lower_bound(alphabet_.begin(), alphabet_.end(), c);
+  return it != alphabet_.end() && *it == c
+             ? static_cast<size_t>(it - alphabet_.begin())
+             : alphabet_.size();
+}
+
+LevenshteinDfa::LevenshteinDfa(const LevenshteinAutomaton& automaton)
+    : automaton_(automaton),
+      symbol_count_(automaton.GetSymbolCount()),
+      ascii_symbols_(ASCII_SIZE),
+      scratch_(automaton.Start()) {
+  for (char32_t c = 0; c < ASCII_SIZE; ++c) {
+    ascii_symbols_[c] = static_cast<uint32_t>(automaton_.GetSymbol(c));
+  }
+  GetId(automaton_.Start());
+}
+
+uint32_t LevenshteinDfa::Start() const { return 0; }
+
+uint32_t LevenshteinDfa::Step(uint32_t state, char32_t c) {
+  const size_t symbol =
+      c < ASCII_SIZE ? ascii_symbols_[c] : automaton_.GetSymbol(c);
+  const size_t index = state * symbol_count_ + symbol;
+  if (transitions_[index] == NO_STATE) {
+    automaton_.Step(states_[state], c, scratch_);
+    const uint32_t next = GetId(scratch_);
+    transitions_[index] = next;
+  }
+  return transitions_[index];
+}
+
+int LevenshteinDfa::GetDistance(uint32_t state) const {
+  return distances_[state];
+}
+
+bool LevenshteinDfa::IsMatch(uint32_t state) const {
+  return automaton_.IsMatch(states_[state]);
+}
+
+bool LevenshteinDfa::CanMatch(uint32_t state) const {
+  return can_match_[state];
+}
+
+uint32_t LevenshteinDfa::GetId(const LevenshteinAutomaton::State& state) {
+  const auto [it, is_new] =
+      state_ids_.emplace(state, static_cast<uint32_t>(states_.size()));
+  if (is_new) {
+    states_.push_back(state);
+    distances_.push_back(static_cast<uint8_t>(automaton_.GetDistance(state)));
+    can_match_.push_back(automaton_.CanMatch(state));
+    transitions_.resize(transitions_.size() + symbol_count_, NO_STATE);
+  }
+  return it->second;
+}
+
+char32_t DecodeUtf8(std::string_view text, size_t& pos) {
+  const auto byte = [&text](size_t i) {
+    return static_cast<uint8_t>(text[i]);
+  };
+  const uint8_t lead = byte(pos);
+  size_t length = 1;
+  char32_t code_point = lead;
+  if (lead >= 0xf8) {
+    length = 1;
+  } else if (lead >= 0xf0) {
+    length = 4;
+    code_point = lead & 0x07;
+  } else if (lead >= 0xe0) {
+    length = 3;
+    code_point = lead & 0x0f;
+  } else if (lead >= 0xc0) {
+    length = 2;
+    code_point = lead & 0x1f;
+  }
+  if (lead < 0x80) {
+    ++pos;
+    return lead;
+  }
+  if (length == 1 || pos + length > text.size()) {
+    ++pos;
+    return INVALID_UTF8_BASE + lead;
+  }
+  for (size_t i = 1; i < length; ++i) {
+    if ((byte(pos + i) & 0xc0) != 0x80) {
+      ++pos;
+      return INVALID_UTF8_BASE + lead;
+    }
+    code_point = (code_point << 6) | (byte(pos + i) & 0x3f);
+  }
+  pos += length;
+  return code_point;
+}
+
+void AppendUtf8(std::string& out, char32_t code_point) {
+  if (code_point >= INVALID_UTF8_BASE) {
+    out.push_back(static_cast<char>(code_point - INVALID_UTF8_BASE));
+  } else if (code_point < 0x80) {
+    out.push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    out.push_back(static_cast<char>(0xc0 | (code_point >> 6)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  } else if (code_point < 0x10000) {
+    out.push_back(static_cast<char>(0xe0 | (code_point >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  } else {
+    out.push_back(static_cast<char>(0xf0 | (code_point >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3f)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// DecodeUtf8 returns this plus the byte for a byte that is not valid UTF-8
+constexpr char32_t INVALID_UTF8_BASE = 0x110000;
+
+// Accepts the words within max_edits insertions, deletions and
+// substitutions of a given word, reading one code point at a time. A state
+// is one row of the edit distance table, so a walk over sorted terms can
+// keep the states of a shared prefix and step only through the rest.
+class LevenshteinAutomaton {
+ public:
+  using State = std::vector<uint8_t>;
+
+  LevenshteinAutomaton(std::string_view word, int max_edits);
+
+  State Start() const;
+  // to must come from Start or an earlier Step; it is overwritten in place
+  void Step(const State& from, char32_t c, State& to) const;
+
+  // Edits between the word and the input read so far
+  int GetDistance(const State& state) const;
+  bool IsMatch(const State& state) const;
+  // False once no continuation of the input can match
+  bool CanMatch(const State& state) const;
+
+  // Smallest code point above after that keeps the input matchable, so
+  // a walk over sorted terms can skip every dead sibling with one seek.
+  // scratch is any state of this automaton.
+  std::optional<char32_t> GetNextViable(const State& from, char32_t after,
+                                        State& scratch) const;
+
+  // Code points that step every state the same way share a symbol: one
+  // for each distinct code point of the word, one for all the others
+  size_t GetSymbolCount() const;
+  size_t GetSymbol(char32_t c) const;
+
+ private:
+  std::vector<char32_t> word_;
+  // Distinct code points of word_, sorted; any other code point steps
+  // the same way
+  std::vector<char32_t> alphabet_;
+  uint8_t max_edits_;
+};
+
+// The automaton as a DFA: states are numbered as a walk first reaches
+// them and each transition is computed once. A walk over a large
+// dictionary meets only a few hundred distinct rows, so nearly every step
+// is a table lookup rather than a row of the edit distance table.
+class LevenshteinDfa {
+ public:
+  explicit LevenshteinDfa(const LevenshteinAutomaton& automaton);
+
+  uint32_t Start() const;
+  uint32_t Step(uint32_t state, char32_t c);
+
+  int GetDistance(uint32_t state) const;
+  bool IsMatch(uint32_t state) const;
+  bool CanMatch(uint32_t state) const;
+
+ private:
+  static constexpr uint32_t NO_STATE = UINT32_MAX;
+  static constexpr char32_t ASCII_SIZE = 128;
+
+  const LevenshteinAutomaton& automaton_;
+  const size_t symbol_count_;
+  std::vector<uint32_t> ascii_symbols_;
+  std::map<LevenshteinAutomaton::State, uint32_t> state_ids_;
+  std::vector<LevenshteinAutomaton::State> states_;
+  std::vector<uint8_t> distances_;
+  std::vector<bool> can_match_;
+  // symbol_count_ entries for each state
+  std::vector<uint32_t> transitions_;
+  LevenshteinAutomaton::State scratch_;
+
+  uint32_t GetId(const LevenshteinAutomaton::State& state);
+};
+
+// Advances pos past one code point
+char32_t DecodeUtf8(std::string_view text, size_t& pos);
+void AppendUtf8(std::string& out, char32_t code_point);
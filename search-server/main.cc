@@ -6,6 +6,7 @@
 #include "process_queries.h"
 #include "remove_duplicates.h"
 #include "search_server.h"
+#include "test_example_functions.h"
 
 using namespace std;
 
@@ -18,6 +19,8 @@ void PrintDocument(const Document& document) {
 }
 
 int main() {
+  TestSearchServer();
+
   SearchServer search_server("and with"s);
   int id = 0;
   for (const string& text : {
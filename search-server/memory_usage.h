@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+// Heap size estimates shared by the GetMemoryUsage and GetMemoryStats
+// methods. They assume libstdc++ containers and a glibc-like malloc.
+
+// Red-black tree node: colour and three pointers ahead of the value
+constexpr size_t MAP_NODE_OVERHEAD = sizeof(void*) * 4;
+// Typical malloc chunk: a size word in front, 16-byte granularity
+constexpr size_t MALLOC_HEADER = sizeof(size_t);
+constexpr size_t MALLOC_ALIGNMENT = 16;
+
+constexpr size_t AllocatedBytes(size_t requested) {
+  if (requested == 0) {
+    return 0;
+  }
+  return (requested + MALLOC_HEADER + MALLOC_ALIGNMENT - 1) /
+         MALLOC_ALIGNMENT * MALLOC_ALIGNMENT;
+}
+
+// One node of a std::map or std::set
+template <typename Container>
+constexpr size_t NodeBytes() {
+  return AllocatedBytes(MAP_NODE_OVERHEAD +
+                        sizeof(typename Container::value_type));
+}
+
+// The buffer of a std::vector
+template <typename Vector>
+size_t BufferBytes(const Vector& values) {
+  return AllocatedBytes(values.capacity() *
+                        sizeof(typename Vector::value_type));
+}
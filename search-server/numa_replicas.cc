@@ -0,0 +1,134 @@
+#include "numa_replicas.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+#include "numa_topology.h"
+#include "search_server.h"
+#include "thread_pool.h"
+
+namespace {
+
+// Runs task on the pool; the future reports its end or its exception
+template <typename Task>
+std::future<void> SubmitTask(ThreadPool& pool, Task task) {
+  auto promise = std::make_shared<std::promise<void>>();
+  std::future<void> future = promise->get_future();
+  pool.Submit([promise, task = std::move(task)] {
+    try {
+      task();
+      promise->set_value();
+    } catch (...) {
+      promise->set_exception(std::current_exception());
+    }
+  });
+  return future;
+}
+
+void WaitAll(std::vector<std::future<void>>& futures) {
+  for (std::future<void>& future : futures) {
+    future.wait();
+  }
+  for (std::future<void>& future : futures) {
+    future.get();
+  }
+}
+
+}  // namespace
+
+NumaReplicas::NumaReplicas(const SearchServer& search_server)
+    : NumaReplicas(search_server, GetNumaNodes()) {}
+
+NumaReplicas::NumaReplicas(const SearchServer& search_server,
+                           std::vector<NumaNode> nodes)
+    : search_server_(search_server), nodes_(std::move(nodes)) {
+  using namespace std::literals;
+  if (nodes_.empty() ||
+      std::any_of(nodes_.begin(), nodes_.end(),
+                  [](const NumaNode& node) { return node.cpus.empty(); })) {
+    throw std::invalid_argument("NO_NUMA_CPUS"s);
+  }
+
+  for (size_t node = 0; node < nodes_.size(); ++node) {
+    for (const int cpu : nodes_[node].cpus) {
+      if (cpu >= static_cast<int>(cpu_to_node_.size())) {
+        cpu_to_node_.resize(cpu + 1, 0);
+      }
+      cpu_to_node_[cpu] = node;
+    }
+    // Pinning is best effort: an unpinned worker is only slower
+    pools_.push_back(std::make_unique<ThreadPool>(
+        nodes_[node].cpus.size(),
+        [cpus = nodes_[node].cpus] { PinCurrentThread(cpus); }));
+  }
+  Rebuild();
+}
+
+void NumaReplicas::Rebuild() {
+  if (nodes_.size() == 1) {
+    return;
+  }
+  replicas_.resize(nodes_.size());
+  std::vector<std::future<void>> built;
+  for (size_t node = 0; node < nodes_.size(); ++node) {
+    built.push_back(SubmitTask(*pools_[node], [this, node] {
+      // Freed first, so that the new replica can reuse the node's memory
+      replicas_[node].reset();
+      replicas_[node] =
+          std::make_unique<SearchServer>(search_server_.MakeReplica());
+    }));
+  }
+  WaitAll(built);
+}
+
+size_t NumaReplicas::GetReplicaCount() const {
+  return std::max<size_t>(replicas_.size(), 1);
+}
+
+const std::vector<NumaNode>& NumaReplicas::GetNodes() const { return nodes_; }
+
+const SearchServer& NumaReplicas::GetLocalReplica() const {
+  const int cpu = GetCurrentCpu();
+  if (cpu < 0 || cpu >= static_cast<int>(cpu_to_node_.size())) {
+    return GetReplica(0);
+  }
+  return GetReplica(cpu_to_node_[cpu]);
+}
+
+std::vector<std::vector<Document>> NumaReplicas::ProcessQueries(
+    const std::vector<std::string>& queries) const {
+  std::vector<std::vector<Document>> answers(queries.size());
+  std::atomic<size_t> next_query = 0;
+  std::vector<std::future<void>> finished;
+  for (size_t node = 0; node < nodes_.size(); ++node) {
+    const SearchServer& replica = GetReplica(node);
+    for (size_t i = 0; i < pools_[node]->GetThreadCount(); ++i) {
+      finished.push_back(SubmitTask(*pools_[node], [&, &replica = replica] {
+        while (true) {
+          const size_t begin = next_query.fetch_add(NUMA_QUERY_BATCH);
+          if (begin >= queries.size()) {
+            return;
+          }
+          const size_t end = std::min(begin + NUMA_QUERY_BATCH, queries.size());
+          for (size_t query = begin; query < end; ++query) {
+            answers[query] = replica.FindTopDocuments(queries[query]);
+          }
+        }
+      }));
+    }
+  }
+  WaitAll(finished);
+  return answers;
+}
+
+const SearchServer& NumaReplicas::GetReplica(size_t node) const {
+  return replicas_.empty() ? search_server_ : *replicas_[node];
+}
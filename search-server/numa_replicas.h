@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "document.h"
+#include "numa_topology.h"
+#include "search_server.h"
+#include "thread_pool.h"
+
+// Queries taken by a worker at a time
+constexpr size_t NUMA_QUERY_BATCH = 8ull;
+
+// Read replicas of a SearchServer, one per NUMA node, each queried by a
+// pool of workers pinned to that node. The workers build their node's
+// replica themselves, so first-touch allocation places it in the node's
+// own memory. With a single node nothing is copied and the workers query
+// the server itself.
+// Replicas are snapshots: call Rebuild after changing the server.
+class NumaReplicas {
+ public:
+  explicit NumaReplicas(const SearchServer& search_server);
+  NumaReplicas(const SearchServer& search_server, std::vector<NumaNode> nodes);
+
+  void Rebuild();
+
+  size_t GetReplicaCount() const;
+  const std::vector<NumaNode>& GetNodes() const;
+
+  // Replica of the node the calling thread runs on
+  const SearchServer& GetLocalReplica() const;
+
+  // Same answers as ProcessQueries. Workers of every node take batches of
+  // queries from a shared counter and answer them from their own replica.
+  std::vector<std::vector<Document>> ProcessQueries(
+      const std::vector<std::string>& queries) const;
+
+ private:
+  const SearchServer& search_server_;
+  std::vector<NumaNode> nodes_;
+  // Index in nodes_ of every CPU
+  std::vector<size_t> cpu_to_node_;
+  // Empty with a single node
+  std::vector<std::unique_ptr<SearchServer>> replicas_;
+  std::vector<std::unique_ptr<ThreadPool>> pools_;
+
+  const SearchServer& GetReplica(size_t node) const;
+};
@@ -0,0 +1,129 @@
+#include "numa_topology.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::vector<int> GetAllowedCpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  if (cpus.empty()) {
+    const int count = std::max(1u, std::thread::hardware_concurrency());
+    for (int cpu = 0; cpu < count; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+bool ParseInt(std::string_view text, int& value) {
+  const auto [end, error] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  return error == std::errc() && end == text.data() + text.size() &&
+         value >= 0;
+}
+
+}  // namespace
+
+std::vector<int> ParseCpuList(std::string_view cpu_list) {
+  while (!cpu_list.empty() &&
+         (cpu_list.back() == '\n' || cpu_list.back() == ' ')) {
+    cpu_list.remove_suffix(1);
+  }
+  std::vector<int> cpus;
+  while (!cpu_list.empty()) {
+    const size_t comma = std::min(cpu_list.find(','), cpu_list.size());
+    const std::string_view range = cpu_list.substr(0, comma);
+    cpu_list.remove_prefix(std::min(comma + 1, cpu_list.size()));
+
+    const size_t dash = range.find('-');
+    int first = 0;
+    int last = 0;
+    if (!ParseInt(range.substr(0, dash), first)) {
+      return {};
+    }
+    if (dash == std::string_view::npos) {
+      last = first;
+    } else if (!ParseInt(range.substr(dash + 1), last) || last < first) {
+      return {};
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+std::vector<NumaNode> GetNumaNodes() {
+  namespace fs = std::filesystem;
+  using namespace std::literals;
+
+  const std::vector<int> allowed_cpus = GetAllowedCpus();
+  std::vector<NumaNode> nodes;
+  std::error_code error;
+  for (fs::directory_iterator it("/sys/devices/system/node"s, error), end;
+       !error && it != end; it.increment(error)) {
+    const std::string name = it->path().filename().string();
+    int id = 0;
+    if (name.rfind("node"s, 0) != 0 ||
+        !ParseInt(std::string_view(name).substr(4), id)) {
+      continue;
+    }
+    std::ifstream input(it->path() / "cpulist"s);
+    std::string cpu_list;
+    std::getline(input, cpu_list);
+
+    NumaNode node{id, {}};
+    for (const int cpu : ParseCpuList(cpu_list)) {
+      if (std::binary_search(allowed_cpus.begin(), allowed_cpus.end(), cpu)) {
+        node.cpus.push_back(cpu);
+      }
+    }
+    // Memory-only nodes and nodes outside our cpuset get no workers
+    if (!node.cpus.empty()) {
+      nodes.push_back(std::move(node));
+    }
+  }
+
+  if (nodes.empty()) {
+    nodes.push_back({0, allowed_cpus});
+  }
+  std::sort(nodes.begin(), nodes.end(),
+            [](const NumaNode& lhs, const NumaNode& rhs) {
+              return lhs.id < rhs.id;
+            });
+  return nodes;
+}
+
+bool PinCurrentThread(const std::vector<int>& cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const int cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  return CPU_COUNT(&set) > 0 &&
+         pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+int GetCurrentCpu() { return sched_getcpu(); }
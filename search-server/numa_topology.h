@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+struct NumaNode {
+  int id;
+  std::vector<int> cpus;
+};
+
+// Nodes with CPUs this process may run on, read from
+// /sys/devices/system/node. Without NUMA information, a single node 0
+// holding every such CPU.
+std::vector<NumaNode> GetNumaNodes();
+
+// Parses a kernel CPU list such as "0-3,8-11"; empty when malformed
+std::vector<int> ParseCpuList(std::string_view cpu_list);
+
+// Restricts the calling thread to the given CPUs; false if the system
+// refuses
+bool PinCurrentThread(const std::vector<int>& cpus);
+
+// CPU the calling thread runs on, or -1 when unknown
+int GetCurrentCpu();
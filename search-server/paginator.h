@@ -1,6 +1,8 @@
 #pragma once
+#include <deque>
 #include <iostream>
 #include <iterator>
+#include <utility>
 #include <vector>
 
 template <typename It>
@@ -29,6 +31,24 @@ class Paginator {
   std::vector<IteratorRange<It>> pages_;
 };
 
+// Pages over a cursor that produces results lazily via NextPage(size).
+// Pages are pulled on first access and cached, so earlier ones stay valid.
+template <typename Cursor>
+class CursorPaginator {
+ public:
+  using Page = decltype(std::declval<Cursor&>().NextPage(size_t{}));
+
+  CursorPaginator(Cursor& cursor, size_t page_size);
+
+  // Empty range when the results end before page_index
+  IteratorRange<typename Page::const_iterator> GetPage(size_t page_index);
+
+ private:
+  Cursor& cursor_;
+  size_t page_size_;
+  std::deque<Page> pages_;
+};
+
 template <typename It>
 IteratorRange<It>::IteratorRange(It begin, It end)
   : begin_(begin), end_(end) {
@@ -70,6 +90,23 @@ auto Paginator<It>::end() const {
   return pages_.end();
 }
 
+template <typename Cursor>
+CursorPaginator<Cursor>::CursorPaginator(Cursor& cursor, size_t page_size)
+  : cursor_(cursor), page_size_(page_size) {
+}
+
+template <typename Cursor>
+IteratorRange<typename CursorPaginator<Cursor>::Page::const_iterator>
+CursorPaginator<Cursor>::GetPage(size_t page_index) {
+  while (pages_.size() <= page_index && !cursor_.IsExhausted()) {
+    pages_.push_back(cursor_.NextPage(page_size_));
+  }
+  if (page_index >= pages_.size()) {
+    return IteratorRange<typename Page::const_iterator>({}, {});
+  }
+  return IteratorRange(pages_[page_index].cbegin(), pages_[page_index].cend());
+}
+
 template <typename It>
 std::ostream& operator<<(std::ostream& os, const IteratorRange<It> page) {
   for (auto it = page.begin(); it != page.end(); std::advance(it, 1)) {
@@ -0,0 +1,125 @@
+#include "position_list.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "memory_usage.h"
+#include "varint.h"
+
+constexpr uint32_t POSITIONS_REMOVED = 1u << 31;
+
+void PositionList::Append(int ordinal, const std::vector<uint32_t>& positions) {
+  ordinals_.push_back(ordinal);
+  offsets_.push_back(static_cast<uint32_t>(bytes_.size()));
+  uint32_t previous = 0;
+  for (const uint32_t position : positions) {
+    AppendVarint(bytes_, position - previous);
+    previous = position;
+  }
+}
+
+void PositionList::Remove(int ordinal) {
+  const size_t index = FindIndex(ordinal);
+  if (index == ordinals_.size()) {
+    return;
+  }
+  offsets_[index] |= POSITIONS_REMOVED;
+  ++removed_count_;
+  if (removed_count_ * 2 > ordinals_.size()) {
+    Compact();
+  }
+}
+
+std::vector<uint32_t> PositionList::Find(int ordinal) const {
+  const size_t index = FindIndex(ordinal);
+  if (index == ordinals_.size()) {
+    return {};
+  }
+  return DecodeDeltas(bytes_.data() + GetBegin(index),
+                      bytes_.data() + GetEnd(index));
+}
+
+size_t PositionList::GetCount() const {
+  return ordinals_.size() - removed_count_;
+}
+
+bool PositionList::IsEmpty() const { return GetCount() == 0; }
+
+size_t PositionList::GetMemoryUsage() const {
+  return BufferBytes(ordinals_) + BufferBytes(offsets_) + BufferBytes(bytes_);
+}
+
+PositionList PositionList::Renumber(const std::vector<int>& new_ordinals) const {
+  std::vector<std::pair<int, size_t>> order;
+  order.reserve(GetCount());
+  size_t byte_count = 0;
+  for (size_t index = 0; index < ordinals_.size(); ++index) {
+    if (!IsRemoved(index)) {
+      order.emplace_back(new_ordinals[ordinals_[index]], index);
+      byte_count += GetEnd(index) - GetBegin(index);
+    }
+  }
+  std::sort(order.begin(), order.end());
+
+  PositionList result;
+  result.Reserve(order.size(), byte_count);
+  for (const auto& [ordinal, index] : order) {
+    result.AppendFrom(*this, index, ordinal);
+  }
+  return result;
+}
+
+size_t PositionList::FindIndex(int ordinal) const {
+  const auto it = std::lower_bound(ordinals_.begin(), ordinals_.end(), ordinal);
+  const size_t index = it - ordinals_.begin();
+  if (it == ordinals_.end() || *it != ordinal || IsRemoved(index)) {
+    return ordinals_.size();
+  }
+  return index;
+}
+
+bool PositionList::IsRemoved(size_t index) const {
+  return (offsets_[index] & POSITIONS_REMOVED) != 0;
+}
+
+size_t PositionList::GetBegin(size_t index) const {
+  return offsets_[index] & ~POSITIONS_REMOVED;
+}
+
+size_t PositionList::GetEnd(size_t index) const {
+  return index + 1 < offsets_.size() ? GetBegin(index + 1) : bytes_.size();
+}
+
+void PositionList::AppendFrom(const PositionList& other, size_t index,
+                              int ordinal) {
+  ordinals_.push_back(ordinal);
+  offsets_.push_back(static_cast<uint32_t>(bytes_.size()));
+  bytes_.insert(bytes_.end(), other.bytes_.begin() + other.GetBegin(index),
+                other.bytes_.begin() + other.GetEnd(index));
+}
+
+void PositionList::Reserve(size_t posting_count, size_t byte_count) {
+  ordinals_.reserve(posting_count);
+  offsets_.reserve(posting_count);
+  bytes_.reserve(byte_count);
+}
+
+void PositionList::Compact() {
+  size_t byte_count = 0;
+  for (size_t index = 0; index < ordinals_.size(); ++index) {
+    if (!IsRemoved(index)) {
+      byte_count += GetEnd(index) - GetBegin(index);
+    }
+  }
+  PositionList result;
+  result.Reserve(GetCount(), byte_count);
+  for (size_t index = 0; index < ordinals_.size(); ++index) {
+    if (!IsRemoved(index)) {
+      result.AppendFrom(*this, index, ordinals_[index]);
+    }
+  }
+  *this = std::move(result);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Word positions of one term in every document that contains it, keyed by
+// document ordinal. The delta-encoded positions of all postings share one
+// byte buffer, so a posting costs its ordinal, its offset and its bytes.
+class PositionList {
+ public:
+  // Ordinals must come in increasing order, as they are handed out
+  void Append(int ordinal, const std::vector<uint32_t>& positions);
+  // Leaves the bytes in place until removed postings make up half of the
+  // list, then compacts it
+  void Remove(int ordinal);
+  // Empty when ordinal has no posting
+  std::vector<uint32_t> Find(int ordinal) const;
+
+  size_t GetCount() const;
+  bool IsEmpty() const;
+  // Heap bytes of the three buffers
+  size_t GetMemoryUsage() const;
+
+  // The live postings under new_ordinals[ordinal]
+  PositionList Renumber(const std::vector<int>& new_ordinals) const;
+
+ private:
+  std::vector<int> ordinals_;
+  // Start of each posting in bytes_, which limits a term to 2 GiB of
+  // positions; the top bit marks a removed posting
+  std::vector<uint32_t> offsets_;
+  std::vector<uint8_t> bytes_;
+  size_t removed_count_ = 0;
+
+  // ordinals_.size() when there is no live posting for ordinal
+  size_t FindIndex(int ordinal) const;
+  bool IsRemoved(size_t index) const;
+  size_t GetBegin(size_t index) const;
+  size_t GetEnd(size_t index) const;
+  void Reserve(size_t posting_count, size_t byte_count);
+  void AppendFrom(const PositionList& other, size_t index, int ordinal);
+  void Compact();
+};
@@ -1,3 +1,5 @@
+#include "process_queries.h"
+
 #include <algorithm>
 #include <execution>
 #include <string>
@@ -5,10 +7,11 @@
 
 #include "document.h"
 #include "search_server.h"
+#include "sharded_search_server.h"
 
-std::vector<std::vector<Document>> ProcessQueries(
-    const SearchServer& search_server,
-    const std::vector<std::string>& queries) {
+template <typename Server>
+static std::vector<std::vector<Document>> ProcessQueriesInternal(
+    const Server& search_server, const std::vector<std::string>& queries) {
   std::vector<std::vector<Document>> answers(queries.size());
   std::transform(std::execution::par, queries.cbegin(), queries.cend(),
                  answers.begin(), [&search_server](const std::string& q) {
@@ -17,12 +20,36 @@ std::vector<std::vector<Document>> ProcessQueries(
   return answers;
 }
 
-std::vector<Document> ProcessQueriesJoined(
-    const SearchServer& search_server,
-    const std::vector<std::string>& queries) {
+template <typename Server>
+static std::vector<Document> ProcessQueriesJoinedInternal(
+    const Server& search_server, const std::vector<std::string>& queries) {
   std::vector<Document> result;
   for (const auto& documents : ProcessQueries(search_server, queries)) {
     result.insert(result.end(), documents.cbegin(), documents.cend());
   }
   return result;
-}
\ No newline at end of file
+}
+
+std::vector<std::vector<Document>> ProcessQueries(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries) {
+  return ProcessQueriesInternal(search_server, queries);
+}
+
+std::vector<Document> ProcessQueriesJoined(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries) {
+  return ProcessQueriesJoinedInternal(search_server, queries);
+}
+
+std::vector<std::vector<Document>> ProcessQueries(
+    const ShardedSearchServer& search_server,
+    const std::vector<std::string>& queries) {
+  return ProcessQueriesInternal(search_server, queries);
+}
+
+std::vector<Document> ProcessQueriesJoined(
+    const ShardedSearchServer& search_server,
+    const std::vector<std::string>& queries) {
+  return ProcessQueriesJoinedInternal(search_server, queries);
+}
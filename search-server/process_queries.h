@@ -5,9 +5,18 @@
 
 #include "document.h"
 #include "search_server.h"
+#include "sharded_search_server.h"
 
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server, const std::vector<std::string>& queries);
 
 std::vector<Document> ProcessQueriesJoined(
-    const SearchServer& search_server, const std::vector<std::string>& queries);
\ No newline at end of file
+    const SearchServer& search_server, const std::vector<std::string>& queries);
+
+std::vector<std::vector<Document>> ProcessQueries(
+    const ShardedSearchServer& search_server,
+    const std::vector<std::string>& queries);
+
+std::vector<Document> ProcessQueriesJoined(
+    const ShardedSearchServer& search_server,
+    const std::vector<std::string>& queries);
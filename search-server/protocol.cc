@@ -0,0 +1,255 @@
+#include "protocol.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+namespace {
+
+class ByteWriter {
+ public:
+  explicit ByteWriter(std::string& out) : out_(out) {}
+
+  void WriteUint(uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+      out_.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+  }
+
+  void WriteInt(int value) { WriteUint(static_cast<uint32_t>(value), 4); }
+
+  void WriteDouble(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    WriteUint(bits, 8);
+  }
+
+  void WriteString(std::string_view str) {
+    WriteUint(str.size(), 4);
+    out_.append(str);
+  }
+
+ private:
+  std::string& out_;
+};
+
+class ByteReader {
+ public:
+  explicit ByteReader(std::string_view data) : data_(data) {}
+
+  uint64_t ReadUint(size_t size) {
+    Require(size);
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+      value |= static_cast<uint64_t>(static_cast<uint8_t>(data_[i])) << (8 * i);
+    }
+    data_.remove_prefix(size);
+    return value;
+  }
+
+  int ReadInt() { return static_cast<int>(static_cast<uint32_t>(ReadUint(4))); }
+
+  double ReadDouble() {
+    const uint64_t bits = ReadUint(8);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  std::string ReadString() {
+    const size_t size = ReadUint(4);
+    Require(size);
+    std::string str(data_.substr(0, size));
+    data_.remove_prefix(size);
+    return str;
+  }
+
+  DocumentStatus ReadStatus() {
+    const auto status = ReadUint(1);
+    if (status > static_cast<uint64_t>(DocumentStatus::REMOVED)) {
+      using namespace std::literals;
+      throw std::invalid_argument("BAD_FRAME_STATUS"s);
+    }
+    return static_cast<DocumentStatus>(status);
+  }
+
+  void ExpectEnd() const {
+    using namespace std::literals;
+    if (!data_.empty()) {
+      throw std::invalid_argument("BAD_FRAME_TRAILING_BYTES"s);
+    }
+  }
+
+ private:
+  std::string_view data_;
+
+  void Require(size_t size) const {
+    using namespace std::literals;
+    if (data_.size() < size) {
+      throw std::invalid_argument("BAD_FRAME_TRUNCATED"s);
+    }
+  }
+};
+
+}  // namespace
+
+// Reserves the size header and fills it in once the payload is written
+template <typename WritePayload>
+static void AppendFrame(std::string& out, WritePayload write_payload) {
+  const size_t header_pos = out.size();
+  out.append(FRAME_HEADER_SIZE, '\0');
+  ByteWriter writer(out);
+  write_payload(writer);
+  const uint32_t payload_size =
+      static_cast<uint32_t>(out.size() - header_pos - FRAME_HEADER_SIZE);
+  for (size_t i = 0; i < FRAME_HEADER_SIZE; ++i) {
+    out[header_pos + i] = static_cast<char>((payload_size >> (8 * i)) & 0xff);
+  }
+}
+
+static RequestType ReadRequestType(ByteReader& reader) {
+  using namespace std::literals;
+  const auto type = reader.ReadUint(1);
+  if (type < static_cast<uint64_t>(RequestType::FIND) ||
+      type > static_cast<uint64_t>(RequestType::REMOVE)) {
+    throw std::invalid_argument("BAD_FRAME_TYPE"s);
+  }
+  return static_cast<RequestType>(type);
+}
+
+void AppendRequestFrame(std::string& out, const Request& request) {
+  AppendFrame(out, [&request](ByteWriter& writer) {
+    writer.WriteUint(request.request_id, 4);
+    writer.WriteUint(static_cast<uint8_t>(request.type), 1);
+    switch (request.type) {
+      case RequestType::FIND:
+        writer.WriteUint(static_cast<uint8_t>(request.status), 1);
+        writer.WriteString(request.text);
+        break;
+      case RequestType::MATCH:
+        writer.WriteInt(request.document_id);
+        writer.WriteString(request.text);
+        break;
+      case RequestType::ADD:
+        writer.WriteInt(request.document_id);
+        writer.WriteUint(static_cast<uint8_t>(request.status), 1);
+        writer.WriteUint(request.ratings.size(), 4);
+        for (const int rating : request.ratings) {
+          writer.WriteInt(rating);
+        }
+        writer.WriteString(request.text);
+        break;
+      case RequestType::REMOVE:
+        writer.WriteInt(request.document_id);
+        break;
+    }
+  });
+}
+
+void AppendResponseFrame(std::string& out, const Response& response) {
+  AppendFrame(out, [&response](ByteWriter& writer) {
+    writer.WriteUint(response.request_id, 4);
+    writer.WriteUint(static_cast<uint8_t>(response.type), 1);
+    writer.WriteUint(static_cast<uint8_t>(response.code), 1);
+    if (response.code == ResponseCode::ERROR) {
+      writer.WriteString(response.error);
+      return;
+    }
+    if (response.type == RequestType::FIND) {
+      writer.WriteUint(response.documents.size(), 4);
+      for (const Document& document : response.documents) {
+        writer.WriteInt(document.id);
+        writer.WriteDouble(document.relevance);
+        writer.WriteInt(document.rating);
+      }
+    } else if (response.type == RequestType::MATCH) {
+      writer.WriteUint(static_cast<uint8_t>(response.status), 1);
+      writer.WriteUint(response.words.size(), 4);
+      for (const std::string& word : response.words) {
+        writer.WriteString(word);
+      }
+    }
+  });
+}
+
+size_t GetFrameSize(std::string_view data) {
+  using namespace std::literals;
+  if (data.size() < FRAME_HEADER_SIZE) {
+    return 0;
+  }
+  const size_t payload_size = ByteReader(data).ReadUint(FRAME_HEADER_SIZE);
+  if (payload_size > MAX_FRAME_SIZE) {
+    throw std::invalid_argument("BAD_FRAME_SIZE"s);
+  }
+  const size_t frame_size = FRAME_HEADER_SIZE + payload_size;
+  return data.size() < frame_size ? 0 : frame_size;
+}
+
+Request ParseRequestFrame(std::string_view frame) {
+  ByteReader reader(frame.substr(FRAME_HEADER_SIZE));
+  Request request;
+  request.request_id = static_cast<uint32_t>(reader.ReadUint(4));
+  request.type = ReadRequestType(reader);
+  switch (request.type) {
+    case RequestType::FIND:
+      request.status = reader.ReadStatus();
+      request.text = reader.ReadString();
+      break;
+    case RequestType::MATCH:
+      request.document_id = reader.ReadInt();
+      request.text = reader.ReadString();
+      break;
+    case RequestType::ADD: {
+      request.document_id = reader.ReadInt();
+      request.status = reader.ReadStatus();
+      const size_t rating_count = reader.ReadUint(4);
+      for (size_t i = 0; i < rating_count; ++i) {
+        request.ratings.push_back(reader.ReadInt());
+      }
+      request.text = reader.ReadString();
+      break;
+    }
+    case RequestType::REMOVE:
+      request.document_id = reader.ReadInt();
+      break;
+  }
+  reader.ExpectEnd();
+  return request;
+}
+
+Response ParseResponseFrame(std::string_view frame) {
+  ByteReader reader(frame.substr(FRAME_HEADER_SIZE));
+  Response response;
+  response.request_id = static_cast<uint32_t>(reader.ReadUint(4));
+  response.type = ReadRequestType(reader);
+  const auto code = reader.ReadUint(1);
+  if (code > static_cast<uint64_t>(ResponseCode::PARTIAL)) {
+    using namespace std::literals;
+    throw std::invalid_argument("BAD_FRAME_CODE"s);
+  }
+  response.code = static_cast<ResponseCode>(code);
+  if (response.code == ResponseCode::ERROR) {
+    response.error = reader.ReadString();
+  } else if (response.type == RequestType::FIND) {
+    const size_t count = reader.ReadUint(4);
+    for (size_t i = 0; i < count; ++i) {
+      const int id = reader.ReadInt();
+      const double relevance = reader.ReadDouble();
+      const int rating = reader.ReadInt();
+      response.documents.emplace_back(id, relevance, rating);
+    }
+  } else if (response.type == RequestType::MATCH) {
+    response.status = reader.ReadStatus();
+    const size_t count = reader.ReadUint(4);
+    for (size_t i = 0; i < count; ++i) {
+      response.words.push_back(reader.ReadString());
+    }
+  }
+  reader.ExpectEnd();
+  return response;
+}
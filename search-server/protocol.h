@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+// Frames on the wire are a little-endian uint32 payload size followed by
+// the payload. Every payload starts with a request id and a request type;
+// responses echo both, so a client may pipeline many requests and match
+// the answers as they come, in any order.
+constexpr size_t FRAME_HEADER_SIZE = 4ull;
+constexpr size_t MAX_FRAME_SIZE = 16ull << 20;
+
+enum class RequestType : uint8_t {
+  FIND = 1,
+  MATCH = 2,
+  ADD = 3,
+  REMOVE = 4,
+};
+
+enum class ResponseCode : uint8_t {
+  OK = 0,
+  ERROR = 1,
+  // FIND stopped by the service's query limits; documents are the best of
+  // what was scored
+  PARTIAL = 2,
+};
+
+// FIND: status, text = query
+// MATCH: document_id, text = query
+// ADD: document_id, status, ratings, text = document
+// REMOVE: document_id
+struct Request {
+  uint32_t request_id = 0;
+  RequestType type = RequestType::FIND;
+  int document_id = 0;
+  DocumentStatus status = DocumentStatus::ACTUAL;
+  std::vector<int> ratings;
+  std::string text;
+};
+
+// FIND: documents; MATCH: words, status; ERROR: error
+struct Response {
+  uint32_t request_id = 0;
+  RequestType type = RequestType::FIND;
+  ResponseCode code = ResponseCode::OK;
+  std::vector<Document> documents;
+  std::vector<std::string> words;
+  DocumentStatus status = DocumentStatus::ACTUAL;
+  std::string error;
+};
+
+void AppendRequestFrame(std::string& out, const Request& request);
+void AppendResponseFrame(std::string& out, const Response& response);
+
+// Size of the complete frame at the start of data, zero if more bytes are
+// needed. Throws std::invalid_argument on frames above MAX_FRAME_SIZE.
+size_t GetFrameSize(std::string_view data);
+
+// Take a whole frame; throw std::invalid_argument if it is malformed
+Request ParseRequestFrame(std::string_view frame);
+Response ParseResponseFrame(std::string_view frame);
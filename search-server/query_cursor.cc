@@ -0,0 +1,59 @@
+#include "query_cursor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "search_server.h"
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+  if (std::abs(lhs.relevance - rhs.relevance) < REL_TOLERANCE) {
+    if (lhs.rating == rhs.rating) {
+      return lhs.id < rhs.id;
+    }
+    return lhs.rating > rhs.rating;
+  }
+  return lhs.relevance > rhs.relevance;
+}
+
+// The heap keeps the most relevant document on top
+static bool IsLessRelevant(const Document& lhs, const Document& rhs) {
+  return IsMoreRelevant(rhs, lhs);
+}
+
+QueryCursor::QueryCursor(std::vector<Document> matched_documents,
+                         bool is_partial)
+    : heap_(std::move(matched_documents)), is_partial_(is_partial) {
+  std::make_heap(heap_.begin(), heap_.end(), IsLessRelevant);
+}
+
+std::vector<Document> QueryCursor::NextPage(size_t page_size) {
+  std::vector<Document> page;
+  page.reserve(std::min(page_size, heap_.size()));
+  while (page.size() < page_size && !heap_.empty()) {
+    std::pop_heap(heap_.begin(), heap_.end(), IsLessRelevant);
+    page.push_back(heap_.back());
+    heap_.pop_back();
+  }
+  returned_count_ += page.size();
+  return page;
+}
+
+bool QueryCursor::IsExhausted() const { return heap_.empty(); }
+
+size_t QueryCursor::GetReturnedCount() const { return returned_count_; }
+
+size_t QueryCursor::GetRemainingCount() const { return heap_.size(); }
+
+bool QueryCursor::IsPartial() const { return is_partial_; }
+
+std::vector<Document> QueryCursor::TakeRemaining() {
+  std::vector<Document> remaining = std::move(heap_);
+  heap_.clear();
+  returned_count_ += remaining.size();
+  return remaining;
+}
+
+CursorPaginator<QueryCursor> Paginate(QueryCursor& cursor, size_t page_size) {
+  return CursorPaginator<QueryCursor>(cursor, page_size);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include "document.h"
+#include "paginator.h"
+
+// Ranking order of search results: relevance, then rating, then id
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+// Holds the scored match set of one query and hands it out in ranking
+// order, page by page, without sorting what is never requested
+class QueryCursor {
+ public:
+  explicit QueryCursor(std::vector<Document> matched_documents,
+                       bool is_partial = false);
+
+  std::vector<Document> NextPage(size_t page_size);
+
+  bool IsExhausted() const;
+  size_t GetReturnedCount() const;
+  size_t GetRemainingCount() const;
+  // The query hit its QueryLimits before scoring every posting
+  bool IsPartial() const;
+
+  // Hands over the documents not returned yet, unordered, and leaves the
+  // cursor exhausted; for merging match sets without sorting them
+  std::vector<Document> TakeRemaining();
+
+ private:
+  std::vector<Document> heap_;
+  size_t returned_count_ = 0;
+  bool is_partial_ = false;
+};
+
+CursorPaginator<QueryCursor> Paginate(QueryCursor& cursor, size_t page_size);
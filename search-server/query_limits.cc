@@ -0,0 +1,47 @@
+#include "query_limits.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+void CancellationToken::Cancel() {
+  is_cancelled_.store(true, std::memory_order_relaxed);
+}
+
+bool CancellationToken::IsCancelled() const {
+  return is_cancelled_.load(std::memory_order_relaxed);
+}
+
+QueryLimits QueryLimits::WithTimeout(
+    std::chrono::steady_clock::duration timeout) {
+  QueryLimits limits;
+  limits.deadline = std::chrono::steady_clock::now() + timeout;
+  return limits;
+}
+
+QueryBudget::QueryBudget(const QueryLimits& limits) : limits_(limits) {}
+
+bool QueryBudget::Spend(size_t postings) {
+  const size_t spent =
+      spent_postings_.fetch_add(postings, std::memory_order_relaxed) +
+      postings;
+  if (is_exhausted_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  if (spent > limits_.max_postings ||
+      (limits_.cancellation != nullptr &&
+       limits_.cancellation->IsCancelled()) ||
+      std::chrono::steady_clock::now() >= limits_.deadline) {
+    is_exhausted_.store(true, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+bool QueryBudget::IsExhausted() const {
+  return is_exhausted_.load(std::memory_order_relaxed);
+}
+
+size_t QueryBudget::GetSpentPostings() const {
+  return spent_postings_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+
+// Postings scanned between two checks of a query's limits
+constexpr size_t QUERY_LIMIT_CHECK_INTERVAL = 256ull;
+
+// Lets another thread stop a query, e.g. once its client has gone away
+class CancellationToken {
+ public:
+  void Cancel();
+  bool IsCancelled() const;
+
+ private:
+  std::atomic<bool> is_cancelled_ = false;
+};
+
+// Bounds on the work of one query. They are checked every
+// QUERY_LIMIT_CHECK_INTERVAL postings, so a query may overrun them by that
+// much per scanning thread.
+struct QueryLimits {
+  std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::time_point::max();
+  size_t max_postings = std::numeric_limits<size_t>::max();
+  const CancellationToken* cancellation = nullptr;
+
+  static QueryLimits WithTimeout(std::chrono::steady_clock::duration timeout);
+};
+
+// Tracks what one query has used of its limits; shared by the threads of a
+// parallel query
+class QueryBudget {
+ public:
+  explicit QueryBudget(const QueryLimits& limits);
+
+  // Accounts for postings already scanned; false once any limit is hit
+  bool Spend(size_t postings);
+  bool IsExhausted() const;
+  size_t GetSpentPostings() const;
+
+ private:
+  QueryLimits limits_;
+  std::atomic<size_t> spent_postings_ = 0;
+  std::atomic<bool> is_exhausted_ = false;
+};
+
+// One thread's view of a QueryBudget: counts postings locally and reports
+// them every QUERY_LIMIT_CHECK_INTERVAL. A null budget never runs out.
+class BudgetMeter {
+ public:
+  explicit BudgetMeter(QueryBudget* budget) : budget_(budget) {}
+
+  // Counts one posting; false once the budget is exhausted
+  bool Tick() {
+    if (budget_ == nullptr || ++unreported_ < QUERY_LIMIT_CHECK_INTERVAL) {
+      return true;
+    }
+    return Check();
+  }
+
+  // Reports what has been counted and checks the limits right away
+  bool Check() {
+    if (budget_ == nullptr) {
+      return true;
+    }
+    const size_t postings = unreported_;
+    unreported_ = 0;
+    return budget_->Spend(postings);
+  }
+
+ private:
+  QueryBudget* budget_;
+  size_t unreported_ = 0;
+};
@@ -0,0 +1,128 @@
+#include "query_log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "document.h"
+#include "varint.h"
+
+static const std::string_view QUERY_LOG_MAGIC = "SSQLOG1\n";
+
+static void HashBytes(uint64_t& hash, uint64_t value, int byte_count) {
+  for (int i = 0; i < byte_count; ++i) {
+    hash ^= (value >> (8 * i)) & 0xff;
+    hash *= 0x100000001b3ull;
+  }
+}
+
+uint64_t HashResult(const std::vector<Document>& documents) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (const Document& document : documents) {
+    HashBytes(hash, static_cast<uint32_t>(document.id), 4);
+    HashBytes(hash, static_cast<uint32_t>(document.rating), 4);
+  }
+  return hash;
+}
+
+QueryLogWriter::QueryLogWriter(const std::string& path)
+    : out_(path, std::ios::binary | std::ios::trunc),
+      buffer_(QUERY_LOG_MAGIC.begin(), QUERY_LOG_MAGIC.end()) {
+  if (!out_) {
+    throw std::system_error(errno, std::generic_category(), "open");
+  }
+}
+
+QueryLogWriter::~QueryLogWriter() {
+  try {
+    Flush();
+  } catch (...) {
+  }
+}
+
+void QueryLogWriter::Write(const QueryLogEntry& entry) {
+  const std::chrono::microseconds arrival =
+      std::max(entry.arrival, previous_arrival_);
+  AppendVarint(buffer_, (arrival - previous_arrival_).count());
+  previous_arrival_ = arrival;
+  AppendVarint(buffer_, std::max<int64_t>(entry.latency.count(), 0));
+  buffer_.push_back(static_cast<uint8_t>(entry.kind));
+  buffer_.push_back(static_cast<uint8_t>(entry.status));
+  for (int i = 0; i < 8; ++i) {
+    buffer_.push_back(static_cast<uint8_t>(entry.result_hash >> (8 * i)));
+  }
+  AppendVarint(buffer_, entry.raw_query.size());
+  buffer_.insert(buffer_.end(), entry.raw_query.begin(),
+                 entry.raw_query.end());
+  if (buffer_.size() >= QUERY_LOG_BUFFER_SIZE) {
+    Flush();
+  }
+}
+
+void QueryLogWriter::Flush() {
+  out_.write(reinterpret_cast<const char*>(buffer_.data()), buffer_.size());
+  out_.flush();
+  buffer_.clear();
+  if (!out_) {
+    throw std::system_error(errno, std::generic_category(), "write");
+  }
+}
+
+static bool ReadEntry(const uint8_t*& pos, const uint8_t* end,
+                      QueryLogEntry& entry) {
+  uint64_t arrival_gap = 0;
+  uint64_t latency = 0;
+  // The log may end mid-entry
+  if (!ReadVarint(pos, end, arrival_gap) || !ReadVarint(pos, end, latency) ||
+      end - pos < 10) {
+    return false;
+  }
+  entry.arrival += std::chrono::microseconds(arrival_gap);
+  entry.latency = std::chrono::microseconds(latency);
+  entry.kind = static_cast<QueryLogEntry::Kind>(*pos++);
+  entry.status = static_cast<DocumentStatus>(*pos++);
+  entry.result_hash = 0;
+  for (int i = 0; i < 8; ++i) {
+    entry.result_hash |= static_cast<uint64_t>(*pos++) << (8 * i);
+  }
+  uint64_t size = 0;
+  if (!ReadVarint(pos, end, size) ||
+      static_cast<uint64_t>(end - pos) < size) {
+    return false;
+  }
+  entry.raw_query.assign(reinterpret_cast<const char*>(pos), size);
+  pos += size;
+  return true;
+}
+
+std::vector<QueryLogEntry> ReadQueryLog(const std::string& path) {
+  using namespace std::literals;
+  std::ifstream input(path, std::ios::binary);
+  if (!input) {
+    throw std::system_error(errno, std::generic_category(), "open");
+  }
+  const std::string data((std::istreambuf_iterator<char>(input)),
+                         std::istreambuf_iterator<char>());
+  if (std::string_view(data).substr(0, QUERY_LOG_MAGIC.size()) !=
+      QUERY_LOG_MAGIC) {
+    throw std::invalid_argument("NOT_A_QUERY_LOG"s);
+  }
+
+  const auto* begin = reinterpret_cast<const uint8_t*>(data.data());
+  const auto* pos = begin + QUERY_LOG_MAGIC.size();
+  const auto* end = begin + data.size();
+  std::vector<QueryLogEntry> entries;
+  QueryLogEntry entry;
+  while (pos != end && ReadEntry(pos, end, entry)) {
+    entries.push_back(entry);
+  }
+  return entries;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "document.h"
+
+// Bytes buffered by QueryLogWriter between writes to the file
+constexpr size_t QUERY_LOG_BUFFER_SIZE = 65536ull;
+
+struct QueryLogEntry {
+  enum class Kind : uint8_t {
+    STATUS = 1,
+    // A predicate cannot be stored, so such entries cannot be replayed
+    PREDICATE = 2,
+  };
+
+  Kind kind = Kind::STATUS;
+  DocumentStatus status = DocumentStatus::ACTUAL;
+  // Since the capture started
+  std::chrono::microseconds arrival{0};
+  // Time the search took when captured
+  std::chrono::microseconds latency{0};
+  uint64_t result_hash = 0;
+  std::string raw_query;
+};
+
+// FNV-1a over the ids and ratings of the documents in rank order.
+// Relevance is left out since its last bits depend on summation order.
+uint64_t HashResult(const std::vector<Document>& documents);
+
+// Appends entries to a new log file. The file starts with a magic line;
+// each entry is [varint arrival gap][varint latency][kind][status]
+// [uint64 hash][varint size][query], times in microseconds.
+class QueryLogWriter {
+ public:
+  // Throws std::system_error if the file cannot be created
+  explicit QueryLogWriter(const std::string& path);
+  ~QueryLogWriter();
+
+  QueryLogWriter(const QueryLogWriter&) = delete;
+  QueryLogWriter& operator=(const QueryLogWriter&) = delete;
+
+  // Entries must come in order of arrival
+  void Write(const QueryLogEntry& entry);
+  void Flush();
+
+ private:
+  std::ofstream out_;
+  std::vector<uint8_t> buffer_;
+  std::chrono::microseconds previous_arrival_{0};
+};
+
+// Throws std::system_error if the file cannot be opened and
+// std::invalid_argument if it is not a query log. An entry cut off at the
+// end, as left by a crash, is dropped.
+std::vector<QueryLogEntry> ReadQueryLog(const std::string& path);
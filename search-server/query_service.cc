@@ -0,0 +1,438 @@
+#include "query_service.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <execution>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "protocol.h"
+
+// Past this many unanswered requests a connection is not read from
+constexpr size_t MAX_PIPELINE_DEPTH = 1024ull;
+constexpr size_t READ_CHUNK_SIZE = 64ull << 10;
+constexpr int MAX_EPOLL_EVENTS = 256;
+constexpr int LISTEN_BACKLOG = 1024;
+
+// epoll user data of the two kinds of non-connection descriptors
+constexpr uint64_t WAKE_ID = ~0ull;
+constexpr uint64_t LISTEN_ID_FLAG = 1ull << 63;
+
+static void ThrowSystemError(const char* what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+static void SetNonBlocking(int fd) {
+  const int flags = fcntl(fd, F_GETFL, 0);
+  if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    ThrowSystemError("fcntl");
+  }
+}
+
+QueryService::QueryService(SearchServer& search_server, ThreadPool& pool)
+    : search_server_(search_server), pool_(pool) {
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    ThrowSystemError("epoll_create1");
+  }
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_fd_ < 0) {
+    ThrowSystemError("eventfd");
+  }
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.u64 = WAKE_ID;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) < 0) {
+    ThrowSystemError("epoll_ctl");
+  }
+}
+
+QueryService::~QueryService() {
+  for (auto& [_, connection] : connections_) {
+    close(connection.fd);
+  }
+  for (const int fd : listen_fds_) {
+    close(fd);
+  }
+  close(wake_fd_);
+  close(epoll_fd_);
+}
+
+void QueryService::ListenUnix(const std::string& path) {
+  using namespace std::literals;
+  sockaddr_un address{};
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw std::invalid_argument("SOCKET_PATH_TOO_LONG"s);
+  }
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  unlink(path.c_str());
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    ThrowSystemError("socket");
+  }
+  if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) <
+      0) {
+    close(fd);
+    ThrowSystemError("bind");
+  }
+  AddListener(fd);
+}
+
+void QueryService::ListenTcp(uint16_t port) {
+  const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    ThrowSystemError("socket");
+  }
+  const int enable = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) <
+      0) {
+    close(fd);
+    ThrowSystemError("bind");
+  }
+  AddListener(fd);
+}
+
+void QueryService::SetQueryLimits(std::chrono::microseconds timeout,
+                                  size_t max_postings) {
+  query_timeout_ = timeout;
+  max_query_postings_ = max_postings;
+}
+
+void QueryService::AddListener(int fd) {
+  if (listen(fd, LISTEN_BACKLOG) < 0) {
+    close(fd);
+    ThrowSystemError("listen");
+  }
+  SetNonBlocking(fd);
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.u64 = LISTEN_ID_FLAG | static_cast<uint64_t>(fd);
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+    close(fd);
+    ThrowSystemError("epoll_ctl");
+  }
+  listen_fds_.push_back(fd);
+}
+
+void QueryService::Run() {
+  epoll_event events[MAX_EPOLL_EVENTS];
+  while (!is_stopping_ || total_in_flight_ > 0) {
+    const int count = epoll_wait(epoll_fd_, events, MAX_EPOLL_EVENTS, -1);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ThrowSystemError("epoll_wait");
+    }
+    // A level-triggered listener with connections in its backlog would
+    // wake every wait while the last queries finish
+    if (is_stopping_ && !listen_fds_.empty()) {
+      CloseListeners();
+    }
+    for (int i = 0; i < count; ++i) {
+      const uint64_t id = events[i].data.u64;
+      if (id == WAKE_ID) {
+        DrainCompletions();
+      } else if (id & LISTEN_ID_FLAG) {
+        if (!is_stopping_) {
+          Accept(static_cast<int>(id & ~LISTEN_ID_FLAG));
+        }
+      } else {
+        // Both directions are shut down or reset: no response can be sent
+        if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+          CloseConnection(id);
+          continue;
+        }
+        if (events[i].events & EPOLLIN) {
+          HandleReadable(id);
+        }
+        if (events[i].events & EPOLLOUT) {
+          HandleWritable(id);
+        }
+      }
+    }
+  }
+}
+
+void QueryService::CloseListeners() {
+  for (const int fd : listen_fds_) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+  }
+  listen_fds_.clear();
+}
+
+void QueryService::Stop() {
+  is_stopping_ = true;
+  const uint64_t one = 1;
+  [[maybe_unused]] const auto written = write(wake_fd_, &one, sizeof(one));
+}
+
+void QueryService::Accept(int listen_fd) {
+  while (true) {
+    const int fd = accept4(listen_fd, nullptr, nullptr,
+                           SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        return;
+      }
+      // Out of descriptors or a connection reset before accept: keep serving
+      return;
+    }
+    const int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    const uint64_t connection_id = next_connection_id_++;
+    Connection& connection = connections_[connection_id];
+    connection.fd = fd;
+    connection.events = EPOLLIN;
+    epoll_event event{};
+    event.events = connection.events;
+    event.data.u64 = connection_id;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+      close(fd);
+      connections_.erase(connection_id);
+    }
+  }
+}
+
+void QueryService::HandleReadable(uint64_t connection_id) {
+  const auto it = connections_.find(connection_id);
+  if (it == connections_.end()) {
+    return;
+  }
+  Connection& connection = it->second;
+  char buffer[READ_CHUNK_SIZE];
+  while (true) {
+    const ssize_t size = read(connection.fd, buffer, sizeof(buffer));
+    if (size > 0) {
+      connection.input.append(buffer, static_cast<size_t>(size));
+      continue;
+    }
+    if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    }
+    if (size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (size == 0) {
+      connection.is_half_closed = true;
+      break;
+    }
+    CloseConnection(connection_id);
+    return;
+  }
+  DispatchFrames(connection_id);
+}
+
+void QueryService::DispatchFrames(uint64_t connection_id) {
+  Connection& connection = connections_.at(connection_id);
+  size_t consumed = 0;
+  while (!is_stopping_ && connection.in_flight < MAX_PIPELINE_DEPTH) {
+    const std::string_view rest =
+        std::string_view(connection.input).substr(consumed);
+    Request request;
+    try {
+      const size_t frame_size = GetFrameSize(rest);
+      if (frame_size == 0) {
+        break;
+      }
+      request = ParseRequestFrame(rest.substr(0, frame_size));
+      consumed += frame_size;
+    } catch (const std::invalid_argument&) {
+      // The stream cannot be resynchronised after a bad frame
+      CloseConnection(connection_id);
+      return;
+    }
+
+    QueryLimits limits;
+    if (query_timeout_.count() > 0) {
+      limits = QueryLimits::WithTimeout(query_timeout_);
+    }
+    limits.max_postings = max_query_postings_;
+
+    ++connection.in_flight;
+    ++total_in_flight_;
+    pool_.Submit([this, connection_id, request = std::move(request), limits,
+                  cancellation = connection.cancellation]() mutable {
+      limits.cancellation = cancellation.get();
+      std::string frame;
+      AppendResponseFrame(frame, Execute(request, limits));
+      {
+        std::lock_guard guard(completions_mutex_);
+        completions_.push_back({connection_id, std::move(frame)});
+      }
+      const uint64_t one = 1;
+      [[maybe_unused]] const auto written = write(wake_fd_, &one, sizeof(one));
+    });
+  }
+  connection.input.erase(0, consumed);
+  UpdateEvents(connection_id);
+}
+
+Response QueryService::Execute(const Request& request,
+                               const QueryLimits& limits) {
+  Response response;
+  response.request_id = request.request_id;
+  response.type = request.type;
+  try {
+    switch (request.type) {
+      case RequestType::FIND: {
+        std::shared_lock lock(index_mutex_);
+        LimitedResult result = search_server_.FindTopDocuments(
+            std::execution::seq, request.text, request.status, limits);
+        response.documents = std::move(result.documents);
+        if (result.is_partial) {
+          response.code = ResponseCode::PARTIAL;
+        }
+        break;
+      }
+      case RequestType::MATCH: {
+        std::shared_lock lock(index_mutex_);
+        const auto [words, status] =
+            search_server_.MatchDocument(request.text, request.document_id);
+        response.words.assign(words.cbegin(), words.cend());
+        response.status = status;
+        break;
+      }
+      case RequestType::ADD: {
+        std::unique_lock lock(index_mutex_);
+        search_server_.AddDocument(request.document_id, request.text,
+                                   request.status, request.ratings);
+        break;
+      }
+      case RequestType::REMOVE: {
+        std::unique_lock lock(index_mutex_);
+        search_server_.RemoveDocument(request.document_id);
+        break;
+      }
+    }
+  } catch (const std::exception& e) {
+    response.code = ResponseCode::ERROR;
+    response.error = e.what();
+  }
+  return response;
+}
+
+void QueryService::DrainCompletions() {
+  uint64_t counter;
+  while (read(wake_fd_, &counter, sizeof(counter)) > 0) {
+  }
+  std::vector<Completion> completions;
+  {
+    std::lock_guard guard(completions_mutex_);
+    completions.swap(completions_);
+  }
+
+  std::vector<uint64_t> touched;
+  for (Completion& completion : completions) {
+    --total_in_flight_;
+    const auto it = connections_.find(completion.connection_id);
+    if (it == connections_.end()) {
+      continue;
+    }
+    --it->second.in_flight;
+    it->second.output += completion.frame;
+    touched.push_back(completion.connection_id);
+  }
+  for (const uint64_t connection_id : touched) {
+    if (connections_.count(connection_id) == 0) {
+      continue;
+    }
+    HandleWritable(connection_id);
+    // Requests held back by the depth limit may go now
+    if (connections_.count(connection_id) != 0) {
+      DispatchFrames(connection_id);
+    }
+  }
+}
+
+void QueryService::HandleWritable(uint64_t connection_id) {
+  const auto it = connections_.find(connection_id);
+  if (it == connections_.end()) {
+    return;
+  }
+  Connection& connection = it->second;
+  size_t written = 0;
+  while (written < connection.output.size()) {
+    const ssize_t size = send(connection.fd, connection.output.data() + written,
+                              connection.output.size() - written, MSG_NOSIGNAL);
+    if (size > 0) {
+      written += static_cast<size_t>(size);
+      continue;
+    }
+    if (size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    }
+    CloseConnection(connection_id);
+    return;
+  }
+  connection.output.erase(0, written);
+  UpdateEvents(connection_id);
+}
+
+void QueryService::UpdateEvents(uint64_t connection_id) {
+  Connection& connection = connections_.at(connection_id);
+  if (connection.is_half_closed && connection.in_flight == 0 &&
+      connection.output.empty()) {
+    // An incomplete frame left in the input can never be finished
+    CloseConnection(connection_id);
+    return;
+  }
+  uint32_t events = 0;
+  // At end of stream the socket stays readable, so it is not polled again
+  if (!connection.is_half_closed &&
+      connection.in_flight < MAX_PIPELINE_DEPTH) {
+    events |= EPOLLIN;
+  }
+  if (!connection.output.empty()) {
+    events |= EPOLLOUT;
+  }
+  if (events == connection.events) {
+    return;
+  }
+  connection.events = events;
+  epoll_event event{};
+  event.events = events;
+  event.data.u64 = connection_id;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event) < 0) {
+    CloseConnection(connection_id);
+  }
+}
+
+void QueryService::CloseConnection(uint64_t connection_id) {
+  const auto it = connections_.find(connection_id);
+  if (it == connections_.end()) {
+    return;
+  }
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, it->second.fd, nullptr);
+  close(it->second.fd);
+  it->second.cancellation->Cancel();
+  // Responses still in the pool are dropped when they complete
+  connections_.erase(it);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "protocol.h"
+#include "query_limits.h"
+#include "search_server.h"
+#include "thread_pool.h"
+
+// Serves the binary protocol from protocol.h. One thread runs a
+// non-blocking epoll loop doing all socket I/O; requests are executed on the
+// worker pool (reads in parallel, writes exclusively) and their responses
+// are handed back to the loop through an eventfd.
+class QueryService {
+ public:
+  QueryService(SearchServer& search_server, ThreadPool& pool);
+  ~QueryService();
+
+  QueryService(const QueryService&) = delete;
+  QueryService& operator=(const QueryService&) = delete;
+
+  void ListenUnix(const std::string& path);
+  // Binds to 127.0.0.1 only
+  void ListenTcp(uint16_t port);
+
+  // Limits for each FIND, the timeout counted from when the request was
+  // read; a zero timeout means none. A FIND that hits them is answered
+  // with ResponseCode::PARTIAL. Must be called before Run.
+  void SetQueryLimits(std::chrono::microseconds timeout, size_t max_postings);
+
+  // Blocks until Stop. Stops accepting connections at once, then waits
+  // for the requests already dispatched to the pool.
+  void Run();
+  // Safe to call from other threads and from signal handlers
+  void Stop();
+
+ private:
+  struct Connection {
+    int fd = -1;
+    std::string input;
+    std::string output;
+    size_t in_flight = 0;
+    uint32_t events = 0;
+    // The peer has shut down its sending side. What it sent before is
+    // still answered; the connection closes once nothing is left to send.
+    bool is_half_closed = false;
+    // Cancelled on close, so that its queries still running stop early
+    std::shared_ptr<CancellationToken> cancellation =
+        std::make_shared<CancellationToken>();
+  };
+
+  struct Completion {
+    uint64_t connection_id;
+    std::string frame;
+  };
+
+  SearchServer& search_server_;
+  ThreadPool& pool_;
+  std::shared_mutex index_mutex_;
+  std::chrono::microseconds query_timeout_{0};
+  size_t max_query_postings_ = std::numeric_limits<size_t>::max();
+
+  int epoll_fd_ = -1;
+  int wake_fd_ = -1;
+  std::vector<int> listen_fds_;
+  std::atomic<bool> is_stopping_ = false;
+
+  uint64_t next_connection_id_ = 0;
+  std::map<uint64_t, Connection> connections_;
+  size_t total_in_flight_ = 0;
+
+  std::mutex completions_mutex_;
+  std::vector<Completion> completions_;
+
+  void AddListener(int fd);
+  void Accept(int listen_fd);
+  // Stops accepting; connections already open are still served
+  void CloseListeners();
+  void HandleReadable(uint64_t connection_id);
+  void HandleWritable(uint64_t connection_id);
+  void DispatchFrames(uint64_t connection_id);
+  void DrainCompletions();
+  void UpdateEvents(uint64_t connection_id);
+  void CloseConnection(uint64_t connection_id);
+
+  Response Execute(const Request& request, const QueryLimits& limits);
+};
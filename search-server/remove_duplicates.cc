@@ -1,22 +1,159 @@
+#include "remove_duplicates.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <execution>
+#include <functional>
+#include <limits>
 #include <map>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "search_server.h"
+#include "string_processing.h"
+
+namespace {
+
+using Signature = std::array<uint64_t, MINHASH_SIGNATURE_SIZE>;
+
+constexpr size_t MINHASH_ROWS_PER_BAND =
+    MINHASH_SIGNATURE_SIZE / MINHASH_BAND_COUNT;
+static_assert(MINHASH_ROWS_PER_BAND * MINHASH_BAND_COUNT ==
+              MINHASH_SIGNATURE_SIZE);
+
+bool HaveSameWords(const std::map<std::string_view, double>& lhs,
+                   const std::map<std::string_view, double>& rhs) {
+  return lhs.size() == rhs.size() &&
+         std::equal(lhs.cbegin(), lhs.cend(), rhs.cbegin(),
+                    [](const auto& l, const auto& r) {
+                      return l.first == r.first;
+                    });
+}
+
+Signature ComputeSignature(const std::map<std::string_view, double>& words) {
+  Signature signature;
+  signature.fill(std::numeric_limits<uint64_t>::max());
+  for (const auto& [word, _] : words) {
+    const uint64_t hash = HashWord(word);
+    for (size_t i = 0; i < MINHASH_SIGNATURE_SIZE; ++i) {
+      signature[i] = std::min(signature[i], MixHash(hash + i));
+    }
+  }
+  return signature;
+}
+
+uint64_t HashBand(const Signature& signature, size_t band) {
+  uint64_t hash = band;
+  for (size_t i = band * MINHASH_ROWS_PER_BAND;
+       i < (band + 1) * MINHASH_ROWS_PER_BAND; ++i) {
+    hash = MixHash(hash ^ signature[i]);
+  }
+  return hash;
+}
+
+double EstimateSimilarity(const Signature& lhs, const Signature& rhs) {
+  size_t equal_count = 0;
+  for (size_t i = 0; i < MINHASH_SIGNATURE_SIZE; ++i) {
+    equal_count += lhs[i] == rhs[i];
+  }
+  return static_cast<double>(equal_count) / MINHASH_SIGNATURE_SIZE;
+}
+
+}  // namespace
 
 void RemoveDuplicates(SearchServer& search_server) {
-  std::map<std::string, std::vector<int>> duplicates;
-  for (const int document_id : search_server) {
-    const auto& word_freqs_ = search_server.GetWordFrequencies(document_id);
-    std::string key;
-    for (const auto& [word, _] : word_freqs_) {
-      key += word;
+  RemoveDuplicates(search_server, [&search_server](int document_id) {
+    return search_server.GetWordSetFingerprint(document_id);
+  });
+}
+
+void RemoveDuplicates(
+    SearchServer& search_server,
+    const std::function<WordSetFingerprint(int document_id)>& fingerprint) {
+  const std::vector<int> ids(search_server.begin(), search_server.end());
+  std::vector<std::pair<WordSetFingerprint, int>> fingerprints(ids.size());
+  std::transform(std::execution::par, ids.cbegin(), ids.cend(),
+                 fingerprints.begin(), [&fingerprint](int document_id) {
+                   return std::pair{fingerprint(document_id), document_id};
+                 });
+  std::sort(std::execution::par, fingerprints.begin(), fingerprints.end());
+
+  std::vector<int> duplicates;
+  for (auto group_begin = fingerprints.cbegin();
+       group_begin != fingerprints.cend();) {
+    const auto group_end = std::find_if(
+        group_begin, fingerprints.cend(), [group_begin](const auto& item) {
+          return item.first != group_begin->first;
+        });
+    // Equal fingerprints almost always mean equal words, but a collision
+    // must not cost us a document
+    std::vector<int> originals;
+    for (auto it = group_begin; it != group_end; ++it) {
+      const auto& words = search_server.GetWordFrequencies(it->second);
+      const bool is_duplicate = std::any_of(
+          originals.cbegin(), originals.cend(),
+          [&search_server, &words](int original_id) {
+            return HaveSameWords(
+                search_server.GetWordFrequencies(original_id), words);
+          });
+      if (is_duplicate) {
+        duplicates.push_back(it->second);
+      } else {
+        originals.push_back(it->second);
+      }
     }
-    duplicates[key].push_back(document_id);
+    group_begin = group_end;
+  }
+
+  search_server.RemoveDocuments(std::execution::par, duplicates);
+}
+
+void RemoveNearDuplicates(SearchServer& search_server,
+                          double similarity_threshold) {
+  using namespace std::literals;
+  if (!(similarity_threshold > 0.0 && similarity_threshold <= 1.0)) {
+    throw std::invalid_argument("INVALID_SIMILARITY_THRESHOLD"s);
   }
-  for (const auto& [_, ids] : duplicates) {
-    for (auto it = ids.cbegin() + 1; it != ids.cend(); ++it) {
-      search_server.RemoveDocument(*it);
+
+  const std::vector<int> ids(search_server.begin(), search_server.end());
+  std::vector<Signature> signatures(ids.size());
+  std::transform(std::execution::par, ids.cbegin(), ids.cend(),
+                 signatures.begin(), [&search_server](int document_id) {
+                   return ComputeSignature(
+                       search_server.GetWordFrequencies(document_id));
+                 });
+
+  // LSH: documents sharing any band bucket become candidates
+  std::vector<std::map<uint64_t, std::vector<size_t>>> buckets(
+      MINHASH_BAND_COUNT);
+  std::vector<int> duplicates;
+  for (size_t i = 0; i < ids.size(); ++i) {
+    std::array<uint64_t, MINHASH_BAND_COUNT> band_hashes;
+    bool is_duplicate = false;
+    for (size_t band = 0; band < MINHASH_BAND_COUNT && !is_duplicate;
+         ++band) {
+      band_hashes[band] = HashBand(signatures[i], band);
+      const auto it = buckets[band].find(band_hashes[band]);
+      if (it == buckets[band].end()) {
+        continue;
+      }
+      is_duplicate = std::any_of(
+          it->second.cbegin(), it->second.cend(), [&](size_t original) {
+            return EstimateSimilarity(signatures[original], signatures[i]) >=
+                   similarity_threshold;
+          });
+    }
+    if (is_duplicate) {
+      duplicates.push_back(ids[i]);
+      continue;
+    }
+    for (size_t band = 0; band < MINHASH_BAND_COUNT; ++band) {
+      buckets[band][band_hashes[band]].push_back(i);
     }
   }
-}
\ No newline at end of file
+
+  search_server.RemoveDocuments(std::execution::par, duplicates);
+}
@@ -1,4 +1,20 @@
 #pragma once
+#include <functional>
+
 #include "search_server.h"
 
-void RemoveDuplicates(SearchServer& search_server);
\ No newline at end of file
+constexpr size_t MINHASH_SIGNATURE_SIZE = 64ull;
+constexpr size_t MINHASH_BAND_COUNT = 16ull;
+
+// Keeps the smallest id among documents with the same set of words
+void RemoveDuplicates(SearchServer& search_server);
+// Groups documents by the given fingerprint instead; documents with equal
+// fingerprints are still compared word by word
+void RemoveDuplicates(
+    SearchServer& search_server,
+    const std::function<WordSetFingerprint(int document_id)>& fingerprint);
+
+// Keeps the smallest id among documents whose estimated Jaccard similarity
+// of word sets is at least similarity_threshold
+void RemoveNearDuplicates(SearchServer& search_server,
+                          double similarity_threshold);
@@ -1,35 +1,61 @@
 #include "request_queue.h"
 
+#include <chrono>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "query_log.h"
+
 RequestQueue::RequestQueue(const SearchServer& search_server)
     : no_result_requests_(0), search_server_(search_server) {  
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query,
                                                    DocumentStatus status) {
+  const auto arrival = std::chrono::steady_clock::now();
   std::vector<Document> result =
       search_server_.FindTopDocuments(raw_query, status);
-  ProcessQueue(raw_query, result, result.empty(), status);
+  ProcessQueue(raw_query, result, result.empty(), status,
+               QueryLogEntry::Kind::STATUS, arrival);
   return result;
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(
     const std::string& raw_query) {
-  std::vector<Document> result =
-      search_server_.FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
-  ProcessQueue(raw_query, result, result.empty(), DocumentStatus::ACTUAL);
-  return result;
+  return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
 }
 
 int RequestQueue::GetNoResultRequests() const {
   return no_result_requests_;
 }
 
+void RequestQueue::StartCapture(const std::string& path) {
+  capture_ = std::make_unique<QueryLogWriter>(path);
+  capture_start_ = std::chrono::steady_clock::now();
+}
+
+void RequestQueue::StopCapture() {
+  if (capture_) {
+    capture_->Flush();
+    capture_.reset();
+  }
+}
+
 void RequestQueue::ProcessQueue(const std::string& raw_query,
                                 const std::vector<Document>& result,
-                                bool is_empty, DocumentStatus status) {
+                                bool is_empty, DocumentStatus status,
+                                QueryLogEntry::Kind kind,
+                                std::chrono::steady_clock::time_point arrival) {
+  if (capture_) {
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    capture_->Write(
+        {kind, status, duration_cast<microseconds>(arrival - capture_start_),
+         duration_cast<microseconds>(std::chrono::steady_clock::now() -
+                                     arrival),
+         HashResult(result), raw_query});
+  }
   if (is_empty) ++no_result_requests_;
   requests_.push_back({{raw_query, status}, result, is_empty});
   if (requests_.size() > min_in_day_) {
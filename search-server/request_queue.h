@@ -1,9 +1,12 @@
 #pragma once
 
+#include <chrono>
 #include <deque>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "query_log.h"
 #include "search_server.h"
 
 const size_t BUFFER_SIZE = 1440;
@@ -20,6 +23,13 @@ class RequestQueue {
   std::vector<Document> AddFindRequest(const std::string& raw_query);
   int GetNoResultRequests() const;
 
+  // Writes every later request to a query log at path, replacing the
+  // file: its query, status, arrival time, search time and a hash of the
+  // result. Requests with a predicate are logged without it.
+  void StartCapture(const std::string& path);
+  // Flushes and closes the log
+  void StopCapture();
+
  private:
   struct QueryData {
     std::string raw_query;
@@ -36,17 +46,22 @@ class RequestQueue {
   int no_result_requests_;
   std::deque<QueryResult> requests_;
   const SearchServer& search_server_;
-  
+  std::unique_ptr<QueryLogWriter> capture_;
+  std::chrono::steady_clock::time_point capture_start_;
+
   void ProcessQueue(const std::string& raw_query,
                     const std::vector<Document>& result, bool is_empty,
-                    DocumentStatus status);
+                    DocumentStatus status, QueryLogEntry::Kind kind,
+                    std::chrono::steady_clock::time_point arrival);
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(
     const std::string& raw_query, DocumentPredicate document_predicate) {
+  const auto arrival = std::chrono::steady_clock::now();
   std::vector<Document> result =
       search_server_.FindTopDocuments(raw_query, document_predicate);
-  ProcessQueue(raw_query, result, result.empty(), DocumentStatus::ACTUAL);
+  ProcessQueue(raw_query, result, result.empty(), DocumentStatus::ACTUAL,
+               QueryLogEntry::Kind::PREDICATE, arrival);
   return result;
 }
\ No newline at end of file
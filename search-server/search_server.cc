@@ -2,7 +2,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <future>
+#include <iterator>
 #include <numeric>
 #include <set>
 #include <stdexcept>
@@ -11,7 +13,10 @@
 #include <tuple>
 #include <vector>
 
+#include "levenshtein_automaton.h"
+#include "memory_usage.h"
 #include "string_processing.h"
+#include "varint.h"
 
 SearchServer::SearchServer(const std::string& stop_words)
     : SearchServer(SplitIntoWords(stop_words)) {}
@@ -19,9 +24,70 @@ SearchServer::SearchServer(const std::string& stop_words)
 SearchServer::SearchServer(std::string_view stop_words)
     : SearchServer(SplitIntoWords(stop_words)) {}
 
+void SearchServer::EnablePositionalIndex(double proximity_weight) {
+  using namespace std::literals;
+  if (!documents_.empty()) {
+    throw std::logic_error("POSITIONS_AFTER_ADD"s);
+  }
+  if (proximity_weight < 0.0) {
+    throw std::invalid_argument("NEGATIVE_PROXIMITY_WEIGHT"s);
+  }
+  has_positions_ = true;
+  proximity_weight_ = proximity_weight;
+}
+
+void SearchServer::EnableFuzzyMatching(int max_edits, double discount) {
+  using namespace std::literals;
+  if (max_edits < 1 || max_edits > 2) {
+    throw std::invalid_argument("INVALID_MAX_EDITS"s);
+  }
+  if (!(discount > 0.0 && discount <= 1.0)) {
+    throw std::invalid_argument("INVALID_FUZZY_DISCOUNT"s);
+  }
+  fuzzy_max_edits_ = max_edits;
+  fuzzy_discount_ = discount;
+  RebuildFuzzyTerms();
+}
+
+void SearchServer::RebuildFuzzyTerms() {
+  std::vector<std::string_view> terms;
+  terms.reserve(word_to_document_freqs_.size());
+  for (const auto& [term, _] : word_to_document_freqs_) {
+    terms.push_back(term);
+  }
+  fuzzy_terms_ = TermTrie(terms);
+  pending_fuzzy_terms_.clear();
+}
+
 void SearchServer::AddDocument(int document_id, std::string_view document,
                                DocumentStatus status,
                                const std::vector<int>& ratings) {
+  CheckNewDocumentId(document_id);
+  TokenizedDocument tokenized{document_id, status, ratings,
+                              std::string(document), {}};
+  Tokenize(tokenized);
+  IndexDocument(std::move(tokenized));
+}
+
+void SearchServer::Tokenize(TokenizedDocument& document) const {
+  using namespace std::literals;
+  if (!IsValidStr(document.text)) {
+    throw std::invalid_argument("INVALID_SYMBOLS"s);
+  }
+  const std::string_view text = document.text;
+  document.words.clear();
+  for (std::string_view word : SplitIntoWordsNoStop(text)) {
+    document.words.emplace_back(static_cast<uint32_t>(word.data() - text.data()),
+                                static_cast<uint32_t>(word.size()));
+  }
+}
+
+void SearchServer::AddDocument(TokenizedDocument&& document) {
+  CheckNewDocumentId(document.id);
+  IndexDocument(std::move(document));
+}
+
+void SearchServer::CheckNewDocumentId(int document_id) const {
   using namespace std::literals;
   if (document_id < 0) {
     throw std::invalid_argument("ADD_DOC_NEGATIVE_ID"s);
@@ -29,40 +95,99 @@ void SearchServer::AddDocument(int document_id, std::string_view document,
   if (documents_.count(document_id) == 1) {
     throw std::invalid_argument("ADD_DOC_SAME_ID"s);
   }
-  if (!IsValidStr(document)) {
-    throw std::invalid_argument("INVALID_SYMBOLS"s);
+}
+
+void SearchServer::IndexDocument(TokenizedDocument&& document) {
+  const int document_id = document.id;
+  if (raw_documents_.count(document_id) != 0) {
+    superseded_documents_.insert(raw_documents_.extract(document_id));
+  }
+  // Words are kept as offsets until here: moving a short string into the
+  // map would invalidate views into its inline buffer
+  const std::string_view text =
+      raw_documents_.emplace(document_id, std::move(document.text))
+          .first->second;
+  std::vector<std::string_view> words;
+  words.reserve(document.words.size());
+  for (const auto& [offset, length] : document.words) {
+    words.push_back(text.substr(offset, length));
   }
-  raw_documents_.emplace(document_id, document);
-  const std::vector<std::string_view> words =
-      SplitIntoWordsNoStop(raw_documents_.at(document_id));
   const double inv_word_count = 1.0 / static_cast<double>(words.size());
+  const int ordinal = static_cast<int>(slots_.size());
 
   for (std::string_view word : words) {
-    word_to_document_freqs_[word][document_id] += inv_word_count;
+    const auto [it, is_new_term] = word_to_document_freqs_.try_emplace(word);
+    it->second[ordinal] += inv_word_count;
     document_to_word_freqs_[document_id][word] += inv_word_count;
+    if (is_new_term && fuzzy_max_edits_ > 0) {
+      pending_fuzzy_terms_.insert(it->first);
+    }
+  }
+  if (pending_fuzzy_terms_.size() >
+      std::max(FUZZY_PENDING_TERMS_MIN, fuzzy_terms_.GetTermCount() / 16)) {
+    RebuildFuzzyTerms();
   }
 
-  documents_.emplace(document_id,
-                     DocumentData{ComputeAverageRating(ratings), status});
+  if (has_positions_) {
+    std::map<std::string_view, std::vector<uint32_t>> word_positions;
+    for (uint32_t position = 0; position < words.size(); ++position) {
+      word_positions[words[position]].push_back(position);
+    }
+    for (const auto& [word, positions] : word_positions) {
+      word_to_document_positions_[word].Append(ordinal, positions);
+    }
+  }
+
+  const int rating = ComputeAverageRating(document.ratings);
+  documents_.emplace(
+      document_id,
+      DocumentData{rating, document.status,
+                   ComputeWordSetFingerprint(GetWordFrequencies(document_id)),
+                   ordinal});
+  slots_.push_back({document_id, rating, document.status});
   ids_.emplace(document_id);
+  status_to_documents_[document.status].Add(ordinal);
+  rating_to_documents_[rating].Add(ordinal);
 }
 
 void SearchServer::RemoveDocumentInternal(int document_id) {
+  const DocumentData& document_data = documents_.at(document_id);
+  status_to_documents_.at(document_data.status).Remove(document_data.ordinal);
+  auto& rating_documents = rating_to_documents_.at(document_data.rating);
+  rating_documents.Remove(document_data.ordinal);
+  if (rating_documents.IsEmpty()) {
+    rating_to_documents_.erase(document_data.rating);
+  }
   document_to_word_freqs_.erase(document_id);
   //raw_documents_.erase(document_id);
+  slots_[document_data.ordinal].id = NO_DOCUMENT;
   documents_.erase(document_id);
   ids_.erase(document_id);
 }
 
+void SearchServer::EraseTerm(std::string_view word) {
+  pending_fuzzy_terms_.erase(word);
+  word_to_document_freqs_.erase(word);
+  word_to_document_positions_.erase(word);
+}
+
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy&,
                                   int document_id) {
   if (ids_.count(document_id) == 0) {
     return;
   }
 
-  const auto& words = document_to_word_freqs_.at(document_id);
+  const int ordinal = documents_.at(document_id).ordinal;
+  const auto& words = GetWordFrequencies(document_id);
   for (const auto& word : words) {
-    word_to_document_freqs_.at(word.first).erase(document_id);
+    auto& postings = word_to_document_freqs_.at(word.first);
+    postings.erase(ordinal);
+    if (has_positions_) {
+      word_to_document_positions_.at(word.first).Remove(ordinal);
+    }
+    if (postings.empty()) {
+      EraseTerm(word.first);
+    }
   }
 
   RemoveDocumentInternal(document_id);
@@ -74,7 +199,7 @@ void SearchServer::RemoveDocument(const std::execution::parallel_policy&,
     return;
   }
 
-  const auto& words = document_to_word_freqs_.at(document_id);
+  const auto& words = GetWordFrequencies(document_id);
 
   std::vector<std::string_view> words_image(words.size());
   std::transform(std::execution::par, words.cbegin(), words.cend(),
@@ -83,10 +208,24 @@ void SearchServer::RemoveDocument(const std::execution::parallel_policy&,
                    return word.first;
                  });
 
-  std::for_each(std::execution::par, words_image.cbegin(), words_image.cend(),
-                [document_id, this](std::string_view w) {
-                  word_to_document_freqs_.at(w).erase(document_id);
-                });
+  const int ordinal = documents_.at(document_id).ordinal;
+  // Erasing from the outer maps is left to one thread
+  std::vector<char> is_emptied(words_image.size());
+  std::transform(std::execution::par, words_image.cbegin(), words_image.cend(),
+                 is_emptied.begin(),
+                 [ordinal, this](std::string_view w) -> char {
+                   auto& postings = word_to_document_freqs_.at(w);
+                   postings.erase(ordinal);
+                   if (has_positions_) {
+                     word_to_document_positions_.at(w).Remove(ordinal);
+                   }
+                   return postings.empty();
+                 });
+  for (size_t i = 0; i < words_image.size(); ++i) {
+    if (is_emptied[i]) {
+      EraseTerm(words_image[i]);
+    }
+  }
 
   RemoveDocumentInternal(document_id);
 }
@@ -95,12 +234,98 @@ void SearchServer::RemoveDocument(int document_id) {
   RemoveDocument(std::execution::seq, document_id);
 }
 
+template <typename ExecutionPolicy>
+RemovalStats SearchServer::RemoveDocumentsInternal(
+    const ExecutionPolicy& policy, const std::vector<int>& document_ids) {
+  std::vector<int> ids;
+  ids.reserve(document_ids.size());
+  std::copy_if(document_ids.cbegin(), document_ids.cend(),
+               std::back_inserter(ids),
+               [this](int document_id) { return ids_.count(document_id); });
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+  // Every posting list is visited once for the whole batch
+  struct TermBatch {
+    std::string_view term;
+    std::vector<int> ids;
+    bool is_emptied = false;
+  };
+  std::map<std::string_view, std::vector<int>> term_to_ids;
+  for (const int document_id : ids) {
+    for (const auto& [word, _] : GetWordFrequencies(document_id)) {
+      term_to_ids[word].push_back(document_id);
+    }
+  }
+  std::vector<TermBatch> batches;
+  batches.reserve(term_to_ids.size());
+  for (auto& [term, term_ids] : term_to_ids) {
+    batches.push_back({term, std::move(term_ids)});
+  }
+
+  std::for_each(policy, batches.begin(), batches.end(),
+                [this](TermBatch& batch) {
+                  auto& postings = word_to_document_freqs_.at(batch.term);
+                  for (const int document_id : batch.ids) {
+                    postings.erase(documents_.at(document_id).ordinal);
+                  }
+                  if (has_positions_) {
+                    auto& positions =
+                        word_to_document_positions_.at(batch.term);
+                    for (const int document_id : batch.ids) {
+                      positions.Remove(documents_.at(document_id).ordinal);
+                    }
+                  }
+                  batch.is_emptied = postings.empty();
+                });
+
+  RemovalStats stats;
+  stats.removed_documents = ids.size();
+  for (const TermBatch& batch : batches) {
+    stats.removed_postings += batch.ids.size();
+    if (batch.is_emptied) {
+      EraseTerm(batch.term);
+      ++stats.removed_terms;
+    }
+  }
+
+  using WordIndex = decltype(word_to_document_freqs_);
+  using PostingList = WordIndex::mapped_type;
+  using ForwardIndex = decltype(document_to_word_freqs_);
+  stats.reclaimed_bytes =
+      stats.removed_postings * (NodeBytes<PostingList>() +
+                                NodeBytes<ForwardIndex::mapped_type>()) +
+      stats.removed_terms * NodeBytes<WordIndex>() +
+      stats.removed_documents *
+          (NodeBytes<ForwardIndex>() + NodeBytes<decltype(documents_)>() +
+           NodeBytes<decltype(ids_)>());
+
+  for (const int document_id : ids) {
+    RemoveDocumentInternal(document_id);
+  }
+  return stats;
+}
+
+RemovalStats SearchServer::RemoveDocuments(
+    const std::execution::sequenced_policy& policy,
+    const std::vector<int>& document_ids) {
+  return RemoveDocumentsInternal(policy, document_ids);
+}
+
+RemovalStats SearchServer::RemoveDocuments(
+    const std::execution::parallel_policy& policy,
+    const std::vector<int>& document_ids) {
+  return RemoveDocumentsInternal(policy, document_ids);
+}
+
+RemovalStats SearchServer::RemoveDocuments(
+    const std::vector<int>& document_ids) {
+  return RemoveDocuments(std::execution::seq, document_ids);
+}
+
 std::vector<Document> SearchServer::FindTopDocuments(
     std::string_view raw_query, DocumentStatus status) const {
-  return FindTopDocuments(
-      raw_query,
-      [status](int /*document_id*/, DocumentStatus document_status,
-               int /*rating*/) { return status == document_status; });
+  return FindTopDocuments(raw_query, DocumentFilter{status});
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(
@@ -108,6 +333,15 @@ std::vector<Document> SearchServer::FindTopDocuments(
   return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+QueryCursor SearchServer::OpenCursor(std::string_view raw_query,
+                                     DocumentStatus status) const {
+  return OpenCursor(std::execution::seq, raw_query, status);
+}
+
+QueryCursor SearchServer::OpenCursor(std::string_view raw_query) const {
+  return OpenCursor(raw_query, DocumentStatus::ACTUAL);
+}
+
 size_t SearchServer::GetDocumentCount() const { return documents_.size(); }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus>
@@ -119,24 +353,7 @@ SearchServer::MatchDocument(const std::execution::sequenced_policy&,
     throw std::out_of_range("id is out of range"s);
   }
 
-  const auto query = ParseQuery(raw_query);
-  std::vector<std::string_view> matched_words;
-
-  for (std::string_view word : query.minus_words) {
-    if (word_to_document_freqs_.count(word) &&
-        word_to_document_freqs_.at(word).count(document_id)) {
-      return std::tuple{matched_words, documents_.at(document_id).status};
-    }
-  }
-
-  for (const std::string_view word : query.plus_words) {
-    if (word_to_document_freqs_.count(word) &&
-        word_to_document_freqs_.at(word).count(document_id)) {
-      matched_words.push_back(word);
-    }
-  }
-
-  return std::tuple{matched_words, documents_.at(document_id).status};
+  return MatchParsedQuery(ParseQuery(raw_query), document_id);
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus>
@@ -148,30 +365,39 @@ SearchServer::MatchDocument(const std::execution::parallel_policy&,
     throw std::out_of_range("id is out of range"s);
   }
 
-  const auto query = ParseQuery(raw_query, false);
+  const auto query = ParseQuery(raw_query);
+  const auto& document_words = GetWordFrequencies(document_id);
+  const DocumentStatus status = documents_.at(document_id).status;
   std::vector<std::string_view> matched_words;
 
-  for (std::string_view word : query.minus_words) {
-    if (word_to_document_freqs_.count(word) &&
-        word_to_document_freqs_.at(word).count(document_id)) {
-      return std::tuple{matched_words, documents_.at(document_id).status};
-    }
+  if (std::any_of(std::execution::par, query.minus_words.cbegin(),
+                  query.minus_words.cend(),
+                  [&document_words](std::string_view word) {
+                    return document_words.count(word) > 0;
+                  }) ||
+      HasMinusPrefix(query, document_id) ||
+      !std::all_of(std::execution::par, query.phrases.cbegin(),
+                   query.phrases.cend(),
+                   [this, document_id](const auto& phrase) {
+                     return ContainsPhrase(document_id, phrase);
+                   })) {
+    return std::tuple{matched_words, status};
   }
 
+  // Plus words are already sorted and unique, so only misses are dropped
   matched_words.resize(query.plus_words.size());
-  const auto new_end = std::copy_if(
-      std::execution::par, query.plus_words.cbegin(), query.plus_words.cend(),
-      matched_words.begin(), [this, document_id](std::string_view word) {
-        return word_to_document_freqs_.count(word) &&
-               word_to_document_freqs_.at(word).count(document_id);
-      });
-
-  matched_words.resize(std::distance(matched_words.begin(), new_end));
-  std::sort(matched_words.begin(), matched_words.end());
-  const auto new_new_end =
-      std::unique(matched_words.begin(), matched_words.end());
-  matched_words.resize(std::distance(matched_words.begin(), new_new_end));
-  return std::tuple{matched_words, documents_.at(document_id).status};
+  std::transform(std::execution::par, query.plus_words.cbegin(),
+                 query.plus_words.cend(), matched_words.begin(),
+                 [&document_words](std::string_view word) {
+                   const auto it = document_words.find(word);
+                   return it == document_words.end() ? std::string_view{}
+                                                     : it->first;
+                 });
+  matched_words.erase(
+      std::remove(matched_words.begin(), matched_words.end(),
+                  std::string_view{}),
+      matched_words.end());
+  return std::tuple{matched_words, status};
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus>
@@ -179,6 +405,106 @@ SearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
   return MatchDocument(std::execution::seq, raw_query, document_id);
 }
 
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+SearchServer::MatchDocuments(const std::execution::sequenced_policy&,
+                             std::string_view raw_query,
+                             const std::vector<int>& document_ids) const {
+  CheckDocumentIds(document_ids);
+  const auto query = ParseQuery(raw_query);
+  std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+      result;
+  result.reserve(document_ids.size());
+  for (const int document_id : document_ids) {
+    result.push_back(MatchParsedQuery(query, document_id));
+  }
+  return result;
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+SearchServer::MatchDocuments(const std::execution::parallel_policy&,
+                             std::string_view raw_query,
+                             const std::vector<int>& document_ids) const {
+  CheckDocumentIds(document_ids);
+  const auto query = ParseQuery(raw_query);
+  std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+      result(document_ids.size());
+  std::transform(std::execution::par, document_ids.cbegin(),
+                 document_ids.cend(), result.begin(),
+                 [this, &query](int document_id) {
+                   return MatchParsedQuery(query, document_id);
+                 });
+  return result;
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+SearchServer::MatchDocuments(std::string_view raw_query,
+                             const std::vector<int>& document_ids) const {
+  return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
+void SearchServer::CheckDocumentIds(
+    const std::vector<int>& document_ids) const {
+  using namespace std::literals;
+  if (std::any_of(document_ids.cbegin(), document_ids.cend(),
+                  [this](int document_id) {
+                    return ids_.count(document_id) == 0;
+                  })) {
+    throw std::out_of_range("id is out of range"s);
+  }
+}
+
+std::vector<std::string_view> SearchServer::IntersectWithDocument(
+    const std::vector<std::string_view>& sorted_words,
+    const std::map<std::string_view, double>& document_words,
+    size_t max_count) {
+  std::vector<std::string_view> result;
+  // A long document against a short query is cheaper to probe than to walk
+  if (document_words.size() > sorted_words.size() * MATCH_MERGE_RATIO) {
+    for (std::string_view word : sorted_words) {
+      const auto it = document_words.find(word);
+      if (it != document_words.end()) {
+        result.push_back(it->first);
+        if (result.size() == max_count) {
+          break;
+        }
+      }
+    }
+    return result;
+  }
+
+  auto word_it = sorted_words.cbegin();
+  auto document_it = document_words.cbegin();
+  while (word_it != sorted_words.cend() &&
+         document_it != document_words.cend() && result.size() < max_count) {
+    if (*word_it < document_it->first) {
+      ++word_it;
+    } else if (document_it->first < *word_it) {
+      ++document_it;
+    } else {
+      result.push_back(document_it->first);
+      ++word_it;
+      ++document_it;
+    }
+  }
+  return result;
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+SearchServer::MatchParsedQuery(const Query& query, int document_id) const {
+  const auto& document_words = GetWordFrequencies(document_id);
+  const DocumentStatus status = documents_.at(document_id).status;
+  if (!IntersectWithDocument(query.minus_words, document_words, 1).empty() ||
+      HasMinusPrefix(query, document_id) ||
+      !std::all_of(query.phrases.cbegin(), query.phrases.cend(),
+                   [this, document_id](const auto& phrase) {
+                     return ContainsPhrase(document_id, phrase);
+                   })) {
+    return std::tuple{std::vector<std::string_view>{}, status};
+  }
+  return std::tuple{IntersectWithDocument(query.plus_words, document_words),
+                    status};
+}
+
 bool SearchServer::IsStopWord(std::string_view word) const {
   return stop_words_.count(word) > 0;
 }
@@ -208,6 +534,18 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) const {
   return rating_sum / static_cast<int>(ratings.size());
 }
 
+WordSetFingerprint SearchServer::ComputeWordSetFingerprint(
+    const std::map<std::string_view, double>& word_freqs) {
+  // Words come sorted, so the order-dependent mix is still a set hash
+  WordSetFingerprint fingerprint{word_freqs.size(), ~word_freqs.size()};
+  for (const auto& [word, _] : word_freqs) {
+    const uint64_t hash = HashWord(word);
+    fingerprint.low = MixHash(fingerprint.low ^ hash);
+    fingerprint.high = MixHash(fingerprint.high + hash * 0x9e3779b97f4a7c15ull);
+  }
+  return fingerprint;
+}
+
 SearchServer::QueryWord SearchServer::ParseQueryWord(
     std::string_view text) const {
   using namespace std::literals;
@@ -223,41 +561,670 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(
   if (text[0] == '-') {
     throw std::invalid_argument("DOUBLE_DASH"s);
   }
-  return {text, is_minus, IsStopWord(text)};
+  if (text.back() == PREFIX_WILDCARD) {
+    text.remove_suffix(1);
+    if (text.empty()) {
+      throw std::invalid_argument("EMPTY_PREFIX"s);
+    }
+    return {text, is_minus, false, true};
+  }
+  return {text, is_minus, IsStopWord(text), false};
 }
 
-SearchServer::Query SearchServer::ParseQuery(std::string_view raw_query,
-                                             bool sort) const {
+std::vector<std::string_view> SearchServer::ExpandPrefix(
+    std::string_view prefix, const CollectionStats* stats) const {
+  const bool is_global =
+      stats != nullptr && stats->prefixes.count(prefix) > 0;
+  // Both term maps are sorted, so the terms with a prefix are one range
+  std::vector<std::pair<size_t, std::string_view>> matches;
+  if (is_global) {
+    for (auto it = stats->document_freqs.lower_bound(prefix);
+         it != stats->document_freqs.end() &&
+         std::string_view(it->first).substr(0, prefix.size()) == prefix;
+         ++it) {
+      if (it->second > 0) {
+        matches.emplace_back(it->second, it->first);
+      }
+    }
+  } else {
+    for (auto it = word_to_document_freqs_.lower_bound(prefix);
+         it != word_to_document_freqs_.end() &&
+         it->first.substr(0, prefix.size()) == prefix;
+         ++it) {
+      if (!it->second.empty()) {
+        matches.emplace_back(it->second.size(), it->first);
+      }
+    }
+  }
+  if (matches.size() > MAX_PREFIX_EXPANSION) {
+    std::partial_sort(matches.begin(), matches.begin() + MAX_PREFIX_EXPANSION,
+                      matches.end(), [](const auto& lhs, const auto& rhs) {
+                        return lhs.first > rhs.first ||
+                               (lhs.first == rhs.first &&
+                                lhs.second < rhs.second);
+                      });
+    matches.resize(MAX_PREFIX_EXPANSION);
+  }
+  std::vector<std::string_view> terms;
+  terms.reserve(matches.size());
+  for (const auto& [_, term] : matches) {
+    if (!is_global) {
+      terms.push_back(term);
+      continue;
+    }
+    // Terms held only by other servers have no postings here
+    const auto it = word_to_document_freqs_.find(term);
+    if (it != word_to_document_freqs_.end()) {
+      terms.push_back(it->first);
+    }
+  }
+  return terms;
+}
+
+std::vector<std::pair<std::string_view, int>> SearchServer::ExpandFuzzy(
+    std::string_view word) const {
+  size_t length = 0;
+  for (size_t pos = 0; pos < word.size(); ++length) {
+    DecodeUtf8(word, pos);
+  }
+  const int max_edits =
+      std::min(fuzzy_max_edits_, length < 3 ? 0 : length < 6 ? 1 : 2);
+  if (max_edits == 0) {
+    return {};
+  }
+  const LevenshteinAutomaton automaton(word, max_edits);
+  // The trie may still hold terms removed since it was built, and a term
+  // removed and added again is in both
+  std::vector<std::pair<std::string_view, int>> found =
+      fuzzy_terms_.FindFuzzy(automaton);
+  for (auto& match : FindFuzzy(pending_fuzzy_terms_, automaton)) {
+    found.push_back(std::move(match));
+  }
+  std::sort(found.begin(), found.end());
+  found.erase(std::unique(found.begin(), found.end()), found.end());
+
+  std::vector<std::tuple<int, size_t, std::string_view>> matches;
+  for (const auto& [term, distance] : found) {
+    if (term == word) {
+      continue;
+    }
+    const auto it = word_to_document_freqs_.find(term);
+    if (it != word_to_document_freqs_.end() && !it->second.empty()) {
+      matches.emplace_back(distance, it->second.size(), it->first);
+    }
+  }
+
+  const auto is_better = [](const auto& lhs, const auto& rhs) {
+    return std::tie(std::get<0>(lhs), std::get<1>(rhs), std::get<2>(lhs)) <
+           std::tie(std::get<0>(rhs), std::get<1>(lhs), std::get<2>(rhs));
+  };
+  if (matches.size() > MAX_FUZZY_EXPANSION) {
+    std::partial_sort(matches.begin(), matches.begin() + MAX_FUZZY_EXPANSION,
+                      matches.end(), is_better);
+    matches.resize(MAX_FUZZY_EXPANSION);
+  }
+  std::vector<std::pair<std::string_view, int>> terms;
+  terms.reserve(matches.size());
+  for (const auto& [distance, _, term] : matches) {
+    terms.emplace_back(term, distance);
+  }
+  return terms;
+}
+
+double SearchServer::Query::GetWordWeight(std::string_view word) const {
+  const auto it = fuzzy_weights.find(word);
+  return it == fuzzy_weights.end() ? 1.0 : it->second;
+}
+
+SearchServer::Query SearchServer::ParseQuery(
+    std::string_view raw_query, bool sort,
+    const CollectionStats* stats) const {
   using namespace std::literals;
   if (!IsValidStr(raw_query)) {
     throw std::invalid_argument("INVALID_SYMBOLS"s);
   }
   Query query;
-  for (std::string_view word : SplitIntoWords(raw_query)) {
+  std::vector<std::string_view> phrase;
+  bool in_phrase = false;
+  const auto add_word = [this, &query, &phrase, &in_phrase,
+                         stats](std::string_view word) {
     const auto query_word = ParseQueryWord(word);
-    if (!query_word.is_stop) {
+    if (in_phrase && query_word.is_minus) {
+      throw std::invalid_argument("MINUS_IN_PHRASE"s);
+    }
+    if (query_word.is_prefix) {
+      if (in_phrase) {
+        throw std::invalid_argument("PREFIX_IN_PHRASE"s);
+      }
+      if (query_word.is_minus) {
+        query.minus_prefixes.push_back(query_word.data);
+      } else {
+        query.plus_prefixes.push_back(query_word.data);
+        for (std::string_view term : ExpandPrefix(query_word.data, stats)) {
+          query.plus_words.push_back(term);
+        }
+      }
+    } else if (!query_word.is_stop) {
       if (query_word.is_minus) {
         query.minus_words.push_back(query_word.data);
       } else {
         query.plus_words.push_back(query_word.data);
+        if (fuzzy_max_edits_ > 0 && !in_phrase) {
+          for (const auto& [term, distance] : ExpandFuzzy(query_word.data)) {
+            double& weight = query.fuzzy_weights[term];
+            weight = std::max(weight, std::pow(fuzzy_discount_, distance));
+          }
+        }
+      }
+      if (in_phrase) {
+        phrase.push_back(query_word.data);
+      }
+    }
+  };
+
+  // A quote that neither opens nor closes a phrase only separates words
+  const auto add_words = [&add_word](std::string_view word) {
+    for (size_t start = 0; start < word.size();) {
+      const size_t quote = std::min(word.find(PHRASE_QUOTE, start),
+                                    word.size());
+      if (quote > start) {
+        add_word(word.substr(start, quote - start));
+      }
+      start = quote + 1;
+    }
+  };
+
+  for (std::string_view word : SplitIntoWords(raw_query)) {
+    if (!has_positions_) {
+      // Without positions "white cat" asks for both words anywhere in the
+      // document
+      add_words(word);
+      continue;
+    }
+    if (!in_phrase && word.front() == PHRASE_QUOTE) {
+      in_phrase = true;
+      phrase.clear();
+      word.remove_prefix(1);
+    }
+    const bool closes_phrase =
+        in_phrase && !word.empty() && word.back() == PHRASE_QUOTE;
+    if (closes_phrase) {
+      word.remove_suffix(1);
+    }
+    add_words(word);
+    if (closes_phrase) {
+      in_phrase = false;
+      // A single quoted word is just a plus word
+      if (phrase.size() > 1) {
+        query.phrases.push_back(phrase);
       }
     }
   }
+  if (in_phrase) {
+    throw std::invalid_argument("UNTERMINATED_PHRASE"s);
+  }
+  // A word typed exactly keeps its full weight
+  for (std::string_view word : query.plus_words) {
+    query.fuzzy_weights.erase(word);
+  }
+  for (const auto& [word, _] : query.fuzzy_weights) {
+    query.plus_words.push_back(word);
+  }
   if (sort) {
-    std::sort(query.plus_words.begin(), query.plus_words.end());
-    const auto new_end =
-        std::unique(query.plus_words.begin(), query.plus_words.end());
-    query.plus_words.resize(std::distance(query.plus_words.begin(), new_end));
+    for (auto* words : {&query.plus_words, &query.minus_words}) {
+      std::sort(words->begin(), words->end());
+      const auto new_end = std::unique(words->begin(), words->end());
+      words->resize(std::distance(words->begin(), new_end));
+    }
   }
   return query;
 }
+const DocBitmap* SearchServer::ResolveFilter(const DocumentFilter& filter,
+                                             DocBitmap& storage) const {
+  static const DocBitmap empty;
+  const DocBitmap* status_documents = nullptr;
+  if (filter.status) {
+    const auto it = status_to_documents_.find(*filter.status);
+    status_documents = it == status_to_documents_.end() ? &empty : &it->second;
+  }
+  if (filter.min_rating == std::numeric_limits<int>::min() &&
+      filter.max_rating == std::numeric_limits<int>::max()) {
+    return status_documents;
+  }
+  if (filter.min_rating > filter.max_rating) {
+    return &empty;
+  }
+
+  std::vector<const DocBitmap*> buckets;
+  for (auto it = rating_to_documents_.lower_bound(filter.min_rating);
+       it != rating_to_documents_.end() && it->first <= filter.max_rating;
+       ++it) {
+    buckets.push_back(&it->second);
+  }
+  storage = DocBitmap::Union(buckets);
+  if (status_documents != nullptr) {
+    storage &= *status_documents;
+  }
+  return &storage;
+}
+
+bool SearchServer::IsAccepted(const AllowedDocuments& allowed,
+                              int ordinal) const {
+  return allowed.bitmap == nullptr || allowed.bitmap->Contains(ordinal);
+}
+
+std::vector<uint32_t> SearchServer::GetWordPositions(std::string_view word,
+                                                     int document_id) const {
+  const auto word_it = word_to_document_positions_.find(word);
+  if (word_it == word_to_document_positions_.end()) {
+    return {};
+  }
+  return word_it->second.Find(documents_.at(document_id).ordinal);
+}
+
+bool SearchServer::ContainsPhrase(
+    int document_id, const std::vector<std::string_view>& phrase) const {
+  // Start positions where the phrase still matches after each word
+  std::vector<uint32_t> starts = GetWordPositions(phrase[0], document_id);
+  for (uint32_t offset = 1; offset < phrase.size() && !starts.empty();
+       ++offset) {
+    const std::vector<uint32_t> positions =
+        GetWordPositions(phrase[offset], document_id);
+    auto position_it = positions.cbegin();
+    auto kept_end = starts.begin();
+    for (const uint32_t start : starts) {
+      position_it =
+          std::lower_bound(position_it, positions.cend(), start + offset);
+      if (position_it != positions.cend() && *position_it == start + offset) {
+        *kept_end++ = start;
+      }
+    }
+    starts.erase(kept_end, starts.end());
+  }
+  return !starts.empty();
+}
+
+double SearchServer::ComputeProximityBoost(
+    int document_id, const std::vector<std::string_view>& words) const {
+  std::vector<std::pair<uint32_t, size_t>> occurrences;
+  for (size_t i = 0; i < words.size(); ++i) {
+    for (const uint32_t position : GetWordPositions(words[i], document_id)) {
+      occurrences.emplace_back(position, i);
+    }
+  }
+  std::sort(occurrences.begin(), occurrences.end());
+  uint32_t min_gap = 0;
+  for (size_t i = 1; i < occurrences.size(); ++i) {
+    if (occurrences[i].second == occurrences[i - 1].second) {
+      continue;
+    }
+    const uint32_t gap = occurrences[i].first - occurrences[i - 1].first;
+    if (min_gap == 0 || gap < min_gap) {
+      min_gap = gap;
+    }
+  }
+  return min_gap == 0 ? 1.0 : 1.0 + proximity_weight_ / min_gap;
+}
+
+void SearchServer::ApplyPositionalConstraints(
+    const Query& query, std::map<int, double>& ordinal_to_relevance) const {
+  if (!has_positions_) {
+    return;
+  }
+  const bool use_proximity =
+      proximity_weight_ > 0.0 && query.plus_words.size() > 1;
+  if (query.phrases.empty() && !use_proximity) {
+    return;
+  }
+  for (auto it = ordinal_to_relevance.begin();
+       it != ordinal_to_relevance.end();) {
+    const int document_id = slots_[it->first].id;
+    const bool has_phrases =
+        std::all_of(query.phrases.cbegin(), query.phrases.cend(),
+                    [this, document_id](const auto& phrase) {
+                      return ContainsPhrase(document_id, phrase);
+                    });
+    if (!has_phrases) {
+      it = ordinal_to_relevance.erase(it);
+      continue;
+    }
+    if (use_proximity) {
+      it->second *= ComputeProximityBoost(document_id, query.plus_words);
+    }
+    ++it;
+  }
+}
+
+bool SearchServer::HasMinusPrefix(const Query& query, int document_id) const {
+  const auto& document_words = GetWordFrequencies(document_id);
+  return std::any_of(
+      query.minus_prefixes.cbegin(), query.minus_prefixes.cend(),
+      [&document_words](std::string_view prefix) {
+        const auto it = document_words.lower_bound(prefix);
+        return it != document_words.end() &&
+               it->first.substr(0, prefix.size()) == prefix;
+      });
+}
+
+void SearchServer::ApplyMinusPrefixes(
+    const Query& query, std::map<int, double>& ordinal_to_relevance) const {
+  if (query.minus_prefixes.empty()) {
+    return;
+  }
+  for (auto it = ordinal_to_relevance.begin();
+       it != ordinal_to_relevance.end();) {
+    if (HasMinusPrefix(query, slots_[it->first].id)) {
+      it = ordinal_to_relevance.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void SearchServer::ApplyMinusWordsToCandidates(
+    const Query& query, std::map<int, double>& ordinal_to_relevance) const {
+  // A word with fewer postings than there are candidates is cheaper to
+  // apply through its postings; the rest are looked up in each candidate
+  std::vector<std::string_view> checked_words;
+  for (std::string_view word : query.minus_words) {
+    const auto it = word_to_document_freqs_.find(word);
+    if (it == word_to_document_freqs_.end()) {
+      continue;
+    }
+    if (it->second.size() <= ordinal_to_relevance.size()) {
+      for (const auto [ordinal, _] : it->second) {
+        ordinal_to_relevance.erase(ordinal);
+      }
+    } else {
+      checked_words.push_back(word);
+    }
+  }
+  if (checked_words.empty()) {
+    return;
+  }
+  for (auto it = ordinal_to_relevance.begin();
+       it != ordinal_to_relevance.end();) {
+    const auto& document_words = GetWordFrequencies(slots_[it->first].id);
+    if (std::any_of(checked_words.cbegin(), checked_words.cend(),
+                    [&document_words](std::string_view word) {
+                      return document_words.count(word) > 0;
+                    })) {
+      it = ordinal_to_relevance.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+std::vector<std::string_view> SearchServer::GetScanOrder(
+    const Query& query, const QueryContext& context) const {
+  std::vector<std::string_view> words = query.plus_words;
+  if (context.budget == nullptr) {
+    return words;
+  }
+  // Rare words weigh the most, so a query cut short has scored them
+  const auto get_document_count = [this](std::string_view word) {
+    const auto it = word_to_document_freqs_.find(word);
+    return it == word_to_document_freqs_.end() ? 0 : it->second.size();
+  };
+  std::stable_sort(words.begin(), words.end(),
+                   [&get_document_count](std::string_view lhs,
+                                         std::string_view rhs) {
+                     return get_document_count(lhs) < get_document_count(rhs);
+                   });
+  return words;
+}
+
 // all documents / documents containing word
 double SearchServer::ComputeWordInverseDocumentFreq(
-    std::string_view word) const {
+    std::string_view word, const QueryContext& context) const {
+  if (context.stats != nullptr) {
+    const auto it = context.stats->document_freqs.find(word);
+    if (it != context.stats->document_freqs.end()) {
+      return std::log(static_cast<double>(context.stats->document_count) /
+                      static_cast<double>(it->second));
+    }
+  }
   return std::log(static_cast<double>(GetDocumentCount()) /
                   static_cast<double>(word_to_document_freqs_.at(word).size()));
 }
 
+CollectionStats SearchServer::GetCollectionStats(
+    std::string_view raw_query) const {
+  CollectionStats stats;
+  stats.document_count = GetDocumentCount();
+  const Query query = ParseQuery(raw_query);
+  for (std::string_view word : query.plus_words) {
+    const auto it = word_to_document_freqs_.find(word);
+    stats.document_freqs.emplace(
+        word, it == word_to_document_freqs_.end() ? 0 : it->second.size());
+  }
+  // Every term of a prefix, since this server's most frequent ones need
+  // not be the most frequent overall
+  for (std::string_view prefix : query.plus_prefixes) {
+    stats.prefixes.emplace(prefix);
+    for (auto it = word_to_document_freqs_.lower_bound(prefix);
+         it != word_to_document_freqs_.end() &&
+         it->first.substr(0, prefix.size()) == prefix;
+         ++it) {
+      stats.document_freqs.emplace(it->first, it->second.size());
+    }
+  }
+  return stats;
+}
+
+CollectionStats& operator+=(CollectionStats& lhs, const CollectionStats& rhs) {
+  lhs.document_count += rhs.document_count;
+  for (const auto& [word, document_freq] : rhs.document_freqs) {
+    lhs.document_freqs[word] += document_freq;
+  }
+  lhs.prefixes.insert(rhs.prefixes.begin(), rhs.prefixes.end());
+  return lhs;
+}
+
+void SearchServer::ReorderDocuments(const std::vector<int>& document_ids) {
+  using namespace std::literals;
+  if (document_ids.size() != documents_.size()) {
+    throw std::invalid_argument("NOT_A_DOCUMENT_ORDER"s);
+  }
+  std::vector<int> new_ordinals(slots_.size(), NO_DOCUMENT);
+  for (size_t i = 0; i < document_ids.size(); ++i) {
+    const auto it = documents_.find(document_ids[i]);
+    if (it == documents_.end() ||
+        new_ordinals[it->second.ordinal] != NO_DOCUMENT) {
+      throw std::invalid_argument("NOT_A_DOCUMENT_ORDER"s);
+    }
+    new_ordinals[it->second.ordinal] = static_cast<int>(i);
+  }
+
+  std::vector<DocumentSlot> slots;
+  slots.reserve(document_ids.size());
+  for (const int document_id : document_ids) {
+    DocumentData& document_data = documents_.at(document_id);
+    slots.push_back(slots_[document_data.ordinal]);
+    document_data.ordinal = new_ordinals[document_data.ordinal];
+  }
+  slots_ = std::move(slots);
+
+  status_to_documents_.clear();
+  rating_to_documents_.clear();
+  for (int ordinal = 0; ordinal < static_cast<int>(slots_.size());
+       ++ordinal) {
+    status_to_documents_[slots_[ordinal].status].Add(ordinal);
+    rating_to_documents_[slots_[ordinal].rating].Add(ordinal);
+  }
+
+  // Built in full before the old lists are freed, so that each new list
+  // gets its nodes one after another instead of in the holes left by the
+  // lists renumbered before it
+  decltype(word_to_document_freqs_) word_to_document_freqs;
+  std::vector<std::pair<int, double>> renumbered;
+  for (const auto& [word, postings] : word_to_document_freqs_) {
+    renumbered.clear();
+    for (const auto [ordinal, term_freq] : postings) {
+      renumbered.emplace_back(new_ordinals[ordinal], term_freq);
+    }
+    std::sort(renumbered.begin(), renumbered.end());
+    // Sorted input makes this linear
+    word_to_document_freqs.emplace_hint(
+        word_to_document_freqs.end(), word,
+        std::map<int, double>(renumbered.begin(), renumbered.end()));
+  }
+  word_to_document_freqs_ = std::move(word_to_document_freqs);
+
+  decltype(word_to_document_positions_) word_to_document_positions;
+  for (const auto& [word, positions] : word_to_document_positions_) {
+    word_to_document_positions.emplace_hint(word_to_document_positions.end(),
+                                            word,
+                                            positions.Renumber(new_ordinals));
+  }
+  word_to_document_positions_ = std::move(word_to_document_positions);
+}
+
+SearchServer SearchServer::MakeReplica() const {
+  SearchServer replica(stop_words_);
+  replica.has_positions_ = has_positions_;
+  replica.proximity_weight_ = proximity_weight_;
+  for (const DocumentSlot& slot : slots_) {
+    if (slot.id != NO_DOCUMENT) {
+      replica.AddDocument(slot.id, raw_documents_.at(slot.id), slot.status,
+                          {slot.rating});
+    }
+  }
+  if (fuzzy_max_edits_ > 0) {
+    replica.EnableFuzzyMatching(fuzzy_max_edits_, fuzzy_discount_);
+  }
+  return replica;
+}
+
+size_t SearchServer::GetEncodedPostingBytes() const {
+  size_t bytes = 0;
+  for (const auto& [_, postings] : word_to_document_freqs_) {
+    int previous = 0;
+    for (const auto [ordinal, _] : postings) {
+      bytes += GetVarintSize(static_cast<uint64_t>(ordinal - previous));
+      previous = ordinal;
+    }
+  }
+  return bytes;
+}
+
+MemoryStats SearchServer::GetMemoryStats() const {
+  using WordIndex = decltype(word_to_document_freqs_);
+  using PostingList = WordIndex::mapped_type;
+  using ForwardIndex = decltype(document_to_word_freqs_);
+  using PositionIndex = decltype(word_to_document_positions_);
+
+  MemoryStats stats;
+  stats.document_count = documents_.size();
+  stats.term_count = word_to_document_freqs_.size();
+  for (const auto& [_, postings] : word_to_document_freqs_) {
+    stats.posting_count += postings.size();
+  }
+  stats.term_dictionary_bytes =
+      stats.term_count * NodeBytes<WordIndex>() +
+      fuzzy_terms_.GetMemoryUsage() +
+      pending_fuzzy_terms_.size() *
+          NodeBytes<decltype(pending_fuzzy_terms_)>();
+  stats.posting_bytes = stats.posting_count * NodeBytes<PostingList>();
+
+  stats.forward_index_bytes =
+      document_to_word_freqs_.size() * NodeBytes<ForwardIndex>();
+  for (const auto& [_, word_freqs] : document_to_word_freqs_) {
+    stats.forward_index_bytes +=
+        word_freqs.size() * NodeBytes<ForwardIndex::mapped_type>();
+  }
+
+  stats.raw_text_bytes =
+      raw_documents_.size() * NodeBytes<decltype(raw_documents_)>();
+  stats.raw_text_bytes +=
+      superseded_documents_.size() * NodeBytes<decltype(raw_documents_)>();
+  const auto count_text = [&stats](const std::string& text) {
+    // Short strings live inside the node itself
+    if (text.capacity() > std::string().capacity()) {
+      stats.raw_text_bytes += AllocatedBytes(text.capacity() + 1);
+    }
+  };
+  for (const auto& [_, text] : raw_documents_) {
+    count_text(text);
+  }
+  for (const auto& [_, text] : superseded_documents_) {
+    count_text(text);
+  }
+
+  stats.metadata_bytes = documents_.size() * NodeBytes<decltype(documents_)>() +
+                         ids_.size() * NodeBytes<decltype(ids_)>() +
+                         BufferBytes(slots_);
+  for (const std::string& word : stop_words_) {
+    stats.metadata_bytes += NodeBytes<decltype(stop_words_)>();
+    if (word.capacity() > std::string().capacity()) {
+      stats.metadata_bytes += AllocatedBytes(word.capacity() + 1);
+    }
+  }
+
+  stats.position_bytes =
+      word_to_document_positions_.size() * NodeBytes<PositionIndex>();
+  for (const auto& [_, positions] : word_to_document_positions_) {
+    stats.position_bytes += positions.GetMemoryUsage();
+  }
+
+  stats.filter_bitmap_bytes =
+      status_to_documents_.size() * NodeBytes<decltype(status_to_documents_)>() +
+      rating_to_documents_.size() * NodeBytes<decltype(rating_to_documents_)>();
+  for (const auto& [_, bitmap] : status_to_documents_) {
+    stats.filter_bitmap_bytes += bitmap.GetMemoryUsage();
+  }
+  for (const auto& [_, bitmap] : rating_to_documents_) {
+    stats.filter_bitmap_bytes += bitmap.GetMemoryUsage();
+  }
+  return stats;
+}
+
+size_t MemoryStats::GetTotalBytes() const {
+  return term_dictionary_bytes + posting_bytes + forward_index_bytes +
+         raw_text_bytes + metadata_bytes + position_bytes + filter_bitmap_bytes;
+}
+
+double MemoryStats::GetAveragePostingLength() const {
+  if (term_count == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(posting_count) / static_cast<double>(term_count);
+}
+
+MemoryStats& operator+=(MemoryStats& lhs, const MemoryStats& rhs) {
+  lhs.term_dictionary_bytes += rhs.term_dictionary_bytes;
+  lhs.posting_bytes += rhs.posting_bytes;
+  lhs.forward_index_bytes += rhs.forward_index_bytes;
+  lhs.raw_text_bytes += rhs.raw_text_bytes;
+  lhs.metadata_bytes += rhs.metadata_bytes;
+  lhs.position_bytes += rhs.position_bytes;
+  lhs.filter_bitmap_bytes += rhs.filter_bitmap_bytes;
+  lhs.document_count += rhs.document_count;
+  lhs.term_count += rhs.term_count;
+  lhs.posting_count += rhs.posting_count;
+  return lhs;
+}
+
+std::ostream& operator<<(std::ostream& os, const MemoryStats& stats) {
+  using namespace std;
+  os << "{ "s
+     << "term_dictionary_bytes = "s << stats.term_dictionary_bytes << ", "s
+     << "posting_bytes = "s << stats.posting_bytes << ", "s
+     << "forward_index_bytes = "s << stats.forward_index_bytes << ", "s
+     << "raw_text_bytes = "s << stats.raw_text_bytes << ", "s
+     << "metadata_bytes = "s << stats.metadata_bytes << ", "s
+     << "position_bytes = "s << stats.position_bytes << ", "s
+     << "filter_bitmap_bytes = "s << stats.filter_bitmap_bytes << ", "s
+     << "total_bytes = "s << stats.GetTotalBytes() << ", "s
+     << "documents = "s << stats.document_count << ", "s
+     << "terms = "s << stats.term_count << ", "s
+     << "postings = "s << stats.posting_count << ", "s
+     << "average_posting_length = "s << stats.GetAveragePostingLength()
+     << " }"s;
+  return os;
+}
+
 std::set<int>::const_iterator SearchServer::begin() const {
   return ids_.cbegin();
 }
@@ -273,3 +1240,26 @@ const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(
   static const std::map<std::string_view, double> dummy;
   return dummy;
 }
+
+WordSetFingerprint SearchServer::GetWordSetFingerprint(int document_id) const {
+  using namespace std::literals;
+  if (documents_.count(document_id) == 0) {
+    throw std::out_of_range("id is out of range"s);
+  }
+  return documents_.at(document_id).fingerprint;
+}
+
+bool SearchServer::ContainsDocument(int document_id) const {
+  return documents_.count(document_id) != 0;
+}
+
+std::tuple<std::string_view, DocumentStatus, int> SearchServer::GetDocument(
+    int document_id) const {
+  using namespace std::literals;
+  if (documents_.count(document_id) == 0) {
+    throw std::out_of_range("id is out of range"s);
+  }
+  const DocumentData& document_data = documents_.at(document_id);
+  return std::tuple{std::string_view(raw_documents_.at(document_id)),
+                    document_data.status, document_data.rating};
+}
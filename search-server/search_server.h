@@ -1,22 +1,135 @@
 #pragma once
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <execution>
+#include <limits>
 #include <list>
 #include <map>
+#include <ostream>
+#include <optional>
 #include <set>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <tuple>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "concurrent_map.h"
+#include "doc_bitmap.h"
 #include "document.h"
+#include "position_list.h"
+#include "query_cursor.h"
+#include "query_limits.h"
 #include "string_processing.h"
+#include "term_trie.h"
 
 constexpr size_t MAX_RESULT_DOCUMENT_COUNT = 5ull;
 constexpr size_t BUCKET_COUNT = 100ull;
 constexpr double REL_TOLERANCE = 1e-6;
+constexpr size_t MATCH_MERGE_RATIO = 8ull;
+constexpr char PHRASE_QUOTE = '"';
+constexpr char PREFIX_WILDCARD = '*';
+// A plus prefix stands for at most this many of its most frequent terms
+constexpr size_t MAX_PREFIX_EXPANSION = 64ull;
+// Likewise for the misspellings of one fuzzy query word
+constexpr size_t MAX_FUZZY_EXPANSION = 64ull;
+// Terms added since the fuzzy term trie was built wait in a sorted set
+// until there are this many of them, or a sixteenth of the trie
+constexpr size_t FUZZY_PENDING_TERMS_MIN = 4096ull;
+constexpr int NO_DOCUMENT = -1;
+
+// 128-bit hash of the set of distinct non-stop words of a document
+struct WordSetFingerprint {
+  uint64_t low = 0;
+  uint64_t high = 0;
+};
+
+inline bool operator==(const WordSetFingerprint& lhs,
+                       const WordSetFingerprint& rhs) {
+  return lhs.low == rhs.low && lhs.high == rhs.high;
+}
+
+inline bool operator!=(const WordSetFingerprint& lhs,
+                       const WordSetFingerprint& rhs) {
+  return !(lhs == rhs);
+}
+
+inline bool operator<(const WordSetFingerprint& lhs,
+                      const WordSetFingerprint& rhs) {
+  return std::tie(lhs.high, lhs.low) < std::tie(rhs.high, rhs.low);
+}
+
+struct RemovalStats {
+  size_t removed_documents = 0;
+  size_t removed_postings = 0;
+  size_t removed_terms = 0;
+  // Estimated like MemoryStats
+  size_t reclaimed_bytes = 0;
+};
+
+// Bytes held by each part of the index, estimated from container sizes
+// and a typical malloc chunk layout
+struct MemoryStats {
+  size_t term_dictionary_bytes = 0;
+  size_t posting_bytes = 0;
+  size_t forward_index_bytes = 0;
+  // Includes the text of removed documents, which is kept alive
+  size_t raw_text_bytes = 0;
+  size_t metadata_bytes = 0;
+  size_t position_bytes = 0;
+  size_t filter_bitmap_bytes = 0;
+
+  size_t document_count = 0;
+  size_t term_count = 0;
+  size_t posting_count = 0;
+
+  size_t GetTotalBytes() const;
+  double GetAveragePostingLength() const;
+};
+
+MemoryStats& operator+=(MemoryStats& lhs, const MemoryStats& rhs);
+std::ostream& operator<<(std::ostream& os, const MemoryStats& stats);
+
+// Document text with the offsets of its non-stop words. Tokenize is const,
+// so it can run on another thread ahead of AddDocument.
+struct TokenizedDocument {
+  int id = 0;
+  DocumentStatus status = DocumentStatus::ACTUAL;
+  std::vector<int> ratings;
+  std::string text;
+  // Offset and length of each non-stop word in text
+  std::vector<std::pair<uint32_t, uint32_t>> words;
+};
+
+// Built-in document filter. Unlike an arbitrary predicate it is resolved
+// against per-status and per-rating bitmaps before postings are scanned.
+struct DocumentFilter {
+  std::optional<DocumentStatus> status;
+  int min_rating = std::numeric_limits<int>::min();
+  int max_rating = std::numeric_limits<int>::max();
+};
+
+// Collection-wide statistics for the words of one query. Passing the sum
+// over several servers makes each of them score with global IDF.
+struct CollectionStats {
+  size_t document_count = 0;
+  std::map<std::string, size_t, std::less<>> document_freqs;
+  // Plus prefixes whose terms are all in document_freqs. Each server then
+  // expands them to the same globally most frequent terms.
+  std::set<std::string, std::less<>> prefixes;
+};
+
+CollectionStats& operator+=(CollectionStats& lhs, const CollectionStats& rhs);
+
+// Top documents of a query run under QueryLimits
+struct LimitedResult {
+  std::vector<Document> documents;
+  // The limits were hit, so only part of the postings were scored
+  bool is_partial = false;
+};
 
 class SearchServer {
  public:
@@ -25,13 +138,40 @@ class SearchServer {
   SearchServer(const std::string& stop_words);
   SearchServer(std::string_view stop_words);
 
+  // Stores word positions for phrase queries ("curly cat") and, with a
+  // positive proximity_weight, boosts documents where query words are close:
+  // relevance *= 1 + proximity_weight / (smallest gap between them).
+  // Must be called before the first AddDocument. Without it, quotes in a
+  // query only separate words.
+  void EnablePositionalIndex(double proximity_weight = 0.0);
+
+  // Lets every plus word outside a phrase also match indexed terms up to
+  // max_edits (1 or 2) edits away. A term d edits away counts with weight
+  // discount^d. Words shorter than 3 letters stay exact, and words shorter
+  // than 6 letters allow at most one edit.
+  void EnableFuzzyMatching(int max_edits = 1, double discount = 0.5);
+
   void AddDocument(int document_id, std::string_view document,
                    DocumentStatus status, const std::vector<int>& ratings);
 
+  // Fills document.words; throws on invalid symbols like AddDocument
+  void Tokenize(TokenizedDocument& document) const;
+  // Throws like AddDocument for a negative or already used id
+  void CheckNewDocumentId(int document_id) const;
+  // Takes over the text without copying it; document must have been
+  // passed to Tokenize
+  void AddDocument(TokenizedDocument&& document);
+
   void RemoveDocument(const std::execution::sequenced_policy&, int document_id);
   void RemoveDocument(const std::execution::parallel_policy&, int document_id);
   void RemoveDocument(int document_id);
 
+  RemovalStats RemoveDocuments(const std::execution::sequenced_policy&,
+                               const std::vector<int>& document_ids);
+  RemovalStats RemoveDocuments(const std::execution::parallel_policy&,
+                               const std::vector<int>& document_ids);
+  RemovalStats RemoveDocuments(const std::vector<int>& document_ids);
+
   template <typename ExecutionPolicy, typename DocumentPredicate>
   std::vector<Document> FindTopDocuments(
       const ExecutionPolicy& policy, std::string_view raw_query,
@@ -55,7 +195,61 @@ class SearchServer {
 
   std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
 
+  template <typename ExecutionPolicy, typename DocumentPredicate>
+  std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
+                                         std::string_view raw_query,
+                                         DocumentPredicate document_predicate,
+                                         const CollectionStats& stats) const;
+
+  // Stops scoring once a limit is hit and ranks what was scored by then.
+  // Rare words are scored first, and minus words still exclude documents.
+  template <typename ExecutionPolicy, typename DocumentPredicate>
+  LimitedResult FindTopDocuments(const ExecutionPolicy& policy,
+                                 std::string_view raw_query,
+                                 DocumentPredicate document_predicate,
+                                 const QueryLimits& limits) const;
+
+  CollectionStats GetCollectionStats(std::string_view raw_query) const;
+
+  // Unlike FindTopDocuments, not capped by MAX_RESULT_DOCUMENT_COUNT:
+  // the match set is scored once and read page by page
+  template <typename ExecutionPolicy, typename DocumentPredicate>
+  QueryCursor OpenCursor(const ExecutionPolicy& policy,
+                         std::string_view raw_query,
+                         DocumentPredicate document_predicate) const;
+
+  template <typename ExecutionPolicy>
+  QueryCursor OpenCursor(const ExecutionPolicy& policy,
+                         std::string_view raw_query,
+                         DocumentStatus status) const;
+
+  template <typename ExecutionPolicy>
+  QueryCursor OpenCursor(const ExecutionPolicy& policy,
+                         std::string_view raw_query) const;
+
+  template <typename DocumentPredicate>
+  QueryCursor OpenCursor(std::string_view raw_query,
+                         DocumentPredicate document_predicate) const;
+
+  QueryCursor OpenCursor(std::string_view raw_query,
+                         DocumentStatus status) const;
+
+  QueryCursor OpenCursor(std::string_view raw_query) const;
+
+  template <typename ExecutionPolicy, typename DocumentPredicate>
+  QueryCursor OpenCursor(const ExecutionPolicy& policy,
+                         std::string_view raw_query,
+                         DocumentPredicate document_predicate,
+                         const CollectionStats& stats) const;
+
+  template <typename ExecutionPolicy, typename DocumentPredicate>
+  QueryCursor OpenCursor(const ExecutionPolicy& policy,
+                         std::string_view raw_query,
+                         DocumentPredicate document_predicate,
+                         const QueryLimits& limits) const;
+
   size_t GetDocumentCount() const;
+  bool ContainsDocument(int document_id) const;
 
   std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(
       const std::execution::sequenced_policy&, std::string_view raw_query,
@@ -68,9 +262,49 @@ class SearchServer {
   std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(
       std::string_view raw_query, int document_id) const;
 
+  std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+  MatchDocuments(const std::execution::sequenced_policy&,
+                 std::string_view raw_query,
+                 const std::vector<int>& document_ids) const;
+
+  std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+  MatchDocuments(const std::execution::parallel_policy&,
+                 std::string_view raw_query,
+                 const std::vector<int>& document_ids) const;
+
+  std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+  MatchDocuments(std::string_view raw_query,
+                 const std::vector<int>& document_ids) const;
+
   const std::map<std::string_view, double>& GetWordFrequencies(
       int document_id) const;
 
+  WordSetFingerprint GetWordSetFingerprint(int document_id) const;
+
+  // Text, status and average rating of a stored document
+  std::tuple<std::string_view, DocumentStatus, int> GetDocument(
+      int document_id) const;
+
+  // Walks the containers, so it costs O(terms + documents)
+  MemoryStats GetMemoryStats() const;
+
+  // Renumbers the documents internally in the given order, which must list
+  // every document once. Ids seen by callers do not change; documents
+  // that are close in the order sit close in posting lists, so placing
+  // similar documents together (see ComputeBisectionOrder) shortens the
+  // gaps between postings and keeps a query's accumulators local.
+  void ReorderDocuments(const std::vector<int>& document_ids);
+
+  // Independent copy with the same settings and documents, in the same
+  // internal order. Unlike a plain copy, whose index keys still point into
+  // this server's texts, it owns all of its memory, and that memory is
+  // allocated by the calling thread.
+  SearchServer MakeReplica() const;
+
+  // Size of the posting lists' document numbers stored as varint gaps,
+  // the part of a compressed index that the document order decides
+  size_t GetEncodedPostingBytes() const;
+
   std::set<int>::const_iterator begin() const;
   std::set<int>::const_iterator end() const;
 
@@ -78,51 +312,169 @@ class SearchServer {
   struct DocumentData {
     int rating;
     DocumentStatus status;
+    WordSetFingerprint fingerprint;
+    int ordinal;
+  };
+
+  // What scoring needs of a document, indexed by its ordinal
+  struct DocumentSlot {
+    int id;
+    int rating;
+    DocumentStatus status;
   };
 
   const std::set<std::string, std::less<>> stop_words_;
   std::map<int, std::string> raw_documents_;
+  // Texts of removed documents whose id was added again. Index keys may
+  // still point into them, so their nodes are spliced here untouched.
+  std::multimap<int, std::string> superseded_documents_;
+  // Posting lists are keyed by the document's ordinal, not by its id
   std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
   std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
   std::map<int, DocumentData> documents_;
   std::set<int> ids_;
+  // Ordinals are handed out in order of addition and never reused before
+  // ReorderDocuments; the slots of removed documents hold NO_DOCUMENT
+  std::vector<DocumentSlot> slots_;
+
+  // Keyed by ordinal like the posting lists, so filtering a posting needs
+  // no id lookup; MakeReplica gets them through AddDocument
+  std::map<DocumentStatus, DocBitmap> status_to_documents_;
+  std::map<int, DocBitmap> rating_to_documents_;
+
+  bool has_positions_ = false;
+  double proximity_weight_ = 0.0;
+  int fuzzy_max_edits_ = 0;
+  double fuzzy_discount_ = 1.0;
+  TermTrie fuzzy_terms_;
+  std::set<std::string_view> pending_fuzzy_terms_;
+  // Positions among the document's non-stop words, keyed by ordinal
+  std::map<std::string_view, PositionList> word_to_document_positions_;
 
   bool IsStopWord(std::string_view word) const;
   bool IsValidStr(std::string_view str) const;
+  void IndexDocument(TokenizedDocument&& document);
+  void RebuildFuzzyTerms();
 
   std::vector<std::string_view> SplitIntoWordsNoStop(
       std::string_view text) const;
 
   int ComputeAverageRating(const std::vector<int>& ratings) const;
 
+  static WordSetFingerprint ComputeWordSetFingerprint(
+      const std::map<std::string_view, double>& word_freqs);
+
   struct QueryWord {
     std::string_view data;
     bool is_minus;
     bool is_stop;
+    bool is_prefix;
   };
 
   QueryWord ParseQueryWord(std::string_view text) const;
 
+  // Indexed terms starting with prefix, the most frequent first when
+  // there are more than MAX_PREFIX_EXPANSION of them. With stats covering
+  // the prefix, they are ranked by the frequencies in stats instead.
+  std::vector<std::string_view> ExpandPrefix(
+      std::string_view prefix, const CollectionStats* stats) const;
+
+  // Indexed terms other than word itself within the allowed edits of it,
+  // with their distances; the closest and most frequent first
+  std::vector<std::pair<std::string_view, int>> ExpandFuzzy(
+      std::string_view word) const;
+
   struct Query {
     std::vector<std::string_view> plus_words;
     std::vector<std::string_view> minus_words;
+    // Checked against each candidate's own words instead of being expanded
+    std::vector<std::string_view> minus_prefixes;
+    std::vector<std::string_view> plus_prefixes;
+    std::vector<std::vector<std::string_view>> phrases;
+    // Plus words that only came from fuzzy expansion
+    std::map<std::string_view, double> fuzzy_weights;
+
+    double GetWordWeight(std::string_view word) const;
+  };
+
+  Query ParseQuery(std::string_view raw_query, bool sort = true,
+                   const CollectionStats* stats = nullptr) const;
+
+  struct QueryContext {
+    const CollectionStats* stats = nullptr;
+    QueryBudget* budget = nullptr;
+  };
+
+  // Plus words in the order they are scored
+  std::vector<std::string_view> GetScanOrder(const Query& query,
+                                             const QueryContext& context) const;
+
+  double ComputeWordInverseDocumentFreq(std::string_view word,
+                                        const QueryContext& context) const;
+
+  void CheckDocumentIds(const std::vector<int>& document_ids) const;
+
+  static std::vector<std::string_view> IntersectWithDocument(
+      const std::vector<std::string_view>& sorted_words,
+      const std::map<std::string_view, double>& document_words,
+      size_t max_count = std::numeric_limits<size_t>::max());
+
+  std::tuple<std::vector<std::string_view>, DocumentStatus> MatchParsedQuery(
+      const Query& query, int document_id) const;
+
+  std::vector<uint32_t> GetWordPositions(std::string_view word,
+                                         int document_id) const;
+  bool ContainsPhrase(int document_id,
+                      const std::vector<std::string_view>& phrase) const;
+  double ComputeProximityBoost(int document_id,
+                               const std::vector<std::string_view>& words) const;
+  // The candidates below are keyed by ordinal, as in posting lists
+  void ApplyPositionalConstraints(
+      const Query& query, std::map<int, double>& ordinal_to_relevance) const;
+  bool HasMinusPrefix(const Query& query, int document_id) const;
+  void ApplyMinusPrefixes(const Query& query,
+                          std::map<int, double>& ordinal_to_relevance) const;
+  // For a query stopped before its minus words' postings were scanned;
+  // costs at most about one lookup per candidate and minus word
+  void ApplyMinusWordsToCandidates(
+      const Query& query, std::map<int, double>& ordinal_to_relevance) const;
+
+  // Posting filter for a resolved DocumentFilter; null accepts everything
+  struct AllowedDocuments {
+    const DocBitmap* bitmap = nullptr;
   };
 
-  Query ParseQuery(std::string_view raw_query, bool sort = true) const;
+  const DocBitmap* ResolveFilter(const DocumentFilter& filter,
+                                 DocBitmap& storage) const;
 
-  double ComputeWordInverseDocumentFreq(std::string_view word) const;
+  template <typename DocumentPredicate>
+  bool IsAccepted(const DocumentPredicate& document_predicate,
+                  int ordinal) const;
+  bool IsAccepted(const AllowedDocuments& allowed, int ordinal) const;
+
+  template <typename ExecutionPolicy, typename DocumentPredicate>
+  QueryCursor OpenCursorInternal(const ExecutionPolicy& policy,
+                                 std::string_view raw_query,
+                                 DocumentPredicate document_predicate,
+                                 const QueryContext& context) const;
 
   template <typename DocumentPredicate>
   std::vector<Document> FindAllDocuments(
       const std::execution::sequenced_policy&, const Query& query,
-      DocumentPredicate document_predicate) const;
+      DocumentPredicate document_predicate, const QueryContext& context) const;
 
   template <typename DocumentPredicate>
   std::vector<Document> FindAllDocuments(
       const std::execution::parallel_policy&, const Query& query,
-      DocumentPredicate document_predicate) const;
+      DocumentPredicate document_predicate, const QueryContext& context) const;
 
   void RemoveDocumentInternal(int document_id);
+  // Drops a term whose posting list has become empty
+  void EraseTerm(std::string_view word);
+
+  template <typename ExecutionPolicy>
+  RemovalStats RemoveDocumentsInternal(const ExecutionPolicy& policy,
+                                       const std::vector<int>& document_ids);
 };
 
 template <typename StringContainer>
@@ -142,31 +494,15 @@ template <typename ExecutionPolicy, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(
     const ExecutionPolicy& policy, std::string_view raw_query,
     DocumentPredicate document_predicate) const {
-  const auto query = ParseQuery(raw_query);
-  auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-
-  std::sort(matched_documents.begin(), matched_documents.end(),
-            [](const Document& lhs, const Document& rhs) {
-              if (std::abs(lhs.relevance - rhs.relevance) < REL_TOLERANCE) {
-                return lhs.rating > rhs.rating;
-              }
-              return lhs.relevance > rhs.relevance;
-            });
-
-  if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-    matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-  }
-  return matched_documents;
+  return OpenCursor(policy, raw_query, document_predicate)
+      .NextPage(MAX_RESULT_DOCUMENT_COUNT);
 }
 
 template <typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(
     const ExecutionPolicy& policy, std::string_view raw_query,
     DocumentStatus status) const {
-  return FindTopDocuments(
-      policy, raw_query,
-      [status](int /*document_id*/, DocumentStatus document_status,
-               int /*rating*/) { return status == document_status; });
+  return FindTopDocuments(policy, raw_query, DocumentFilter{status});
 }
 
 template <typename ExecutionPolicy>
@@ -181,42 +517,155 @@ std::vector<Document> SearchServer::FindTopDocuments(
   return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
 }
 
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(
+    const ExecutionPolicy& policy, std::string_view raw_query,
+    DocumentPredicate document_predicate, const CollectionStats& stats) const {
+  return OpenCursor(policy, raw_query, document_predicate, stats)
+      .NextPage(MAX_RESULT_DOCUMENT_COUNT);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+LimitedResult SearchServer::FindTopDocuments(
+    const ExecutionPolicy& policy, std::string_view raw_query,
+    DocumentPredicate document_predicate, const QueryLimits& limits) const {
+  QueryCursor cursor = OpenCursor(policy, raw_query, document_predicate, limits);
+  return {cursor.NextPage(MAX_RESULT_DOCUMENT_COUNT), cursor.IsPartial()};
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+QueryCursor SearchServer::OpenCursor(
+    const ExecutionPolicy& policy, std::string_view raw_query,
+    DocumentPredicate document_predicate) const {
+  return OpenCursorInternal(policy, raw_query, document_predicate,
+                            QueryContext{});
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+QueryCursor SearchServer::OpenCursor(
+    const ExecutionPolicy& policy, std::string_view raw_query,
+    DocumentPredicate document_predicate, const CollectionStats& stats) const {
+  return OpenCursorInternal(policy, raw_query, document_predicate,
+                            QueryContext{&stats});
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+QueryCursor SearchServer::OpenCursor(
+    const ExecutionPolicy& policy, std::string_view raw_query,
+    DocumentPredicate document_predicate, const QueryLimits& limits) const {
+  QueryBudget budget(limits);
+  return OpenCursorInternal(policy, raw_query, document_predicate,
+                            QueryContext{nullptr, &budget});
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+QueryCursor SearchServer::OpenCursorInternal(
+    const ExecutionPolicy& policy, std::string_view raw_query,
+    DocumentPredicate document_predicate, const QueryContext& context) const {
+  if constexpr (std::is_same_v<DocumentPredicate, DocumentStatus>) {
+    return OpenCursorInternal(policy, raw_query,
+                              DocumentFilter{document_predicate}, context);
+  } else {
+    const auto query = ParseQuery(raw_query, true, context.stats);
+    std::vector<Document> matched_documents;
+    if constexpr (std::is_same_v<DocumentPredicate, DocumentFilter>) {
+      DocBitmap storage;
+      const AllowedDocuments allowed{
+          ResolveFilter(document_predicate, storage)};
+      matched_documents = FindAllDocuments(policy, query, allowed, context);
+    } else {
+      matched_documents =
+          FindAllDocuments(policy, query, document_predicate, context);
+    }
+    return QueryCursor(
+        std::move(matched_documents),
+        context.budget != nullptr && context.budget->IsExhausted());
+  }
+}
+
+template <typename ExecutionPolicy>
+QueryCursor SearchServer::OpenCursor(const ExecutionPolicy& policy,
+                                     std::string_view raw_query,
+                                     DocumentStatus status) const {
+  return OpenCursor(policy, raw_query, DocumentFilter{status});
+}
+
+template <typename ExecutionPolicy>
+QueryCursor SearchServer::OpenCursor(const ExecutionPolicy& policy,
+                                     std::string_view raw_query) const {
+  return OpenCursor(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename DocumentPredicate>
+QueryCursor SearchServer::OpenCursor(
+    std::string_view raw_query, DocumentPredicate document_predicate) const {
+  return OpenCursor(std::execution::seq, raw_query, document_predicate);
+}
+
+template <typename DocumentPredicate>
+bool SearchServer::IsAccepted(const DocumentPredicate& document_predicate,
+                              int ordinal) const {
+  const DocumentSlot& slot = slots_[ordinal];
+  return document_predicate(slot.id, slot.status, slot.rating);
+}
+
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindAllDocuments(
     const std::execution::sequenced_policy&, const Query& query,
-    DocumentPredicate document_predicate) const {
+    DocumentPredicate document_predicate, const QueryContext& context) const {
 
-  std::map<int, double> document_to_relevance;
+  std::map<int, double> ordinal_to_relevance;
+  BudgetMeter meter(context.budget);
+  bool is_stopped = !meter.Check();
 
-  for (std::string_view word : query.plus_words) {
+  for (std::string_view word : GetScanOrder(query, context)) {
+    if (is_stopped) {
+      break;
+    }
     if (word_to_document_freqs_.count(word) == 0) {
       continue;
     }
-    const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-    for (const auto [document_id, term_freq] :
+    const double inverse_document_freq =
+        ComputeWordInverseDocumentFreq(word, context) *
+        query.GetWordWeight(word);
+    for (const auto [ordinal, term_freq] :
          word_to_document_freqs_.at(word)) {
-      const auto& document_data = documents_.at(document_id);
-
-      if (document_predicate(document_id, document_data.status,
-                             document_data.rating)) {
-        document_to_relevance[document_id] += term_freq * inverse_document_freq;
+      if (!meter.Tick()) {
+        is_stopped = true;
+        break;
+      }
+      if (IsAccepted(document_predicate, ordinal)) {
+        ordinal_to_relevance[ordinal] += term_freq * inverse_document_freq;
       }
     }
   }
 
   for (std::string_view word : query.minus_words) {
+    if (is_stopped) {
+      break;
+    }
     if (word_to_document_freqs_.count(word) == 0) {
       continue;
     }
-    for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-      document_to_relevance.erase(document_id);
+    for (const auto [ordinal, _] : word_to_document_freqs_.at(word)) {
+      if (!meter.Tick()) {
+        is_stopped = true;
+        break;
+      }
+      ordinal_to_relevance.erase(ordinal);
     }
   }
+  if (is_stopped) {
+    ApplyMinusWordsToCandidates(query, ordinal_to_relevance);
+  }
+
+  ApplyMinusPrefixes(query, ordinal_to_relevance);
+  ApplyPositionalConstraints(query, ordinal_to_relevance);
 
   std::vector<Document> matched_documents;
-  for (const auto [document_id, relevance] : document_to_relevance) {
-    matched_documents.push_back(
-        {document_id, relevance, documents_.at(document_id).rating});
+  for (const auto [ordinal, relevance] : ordinal_to_relevance) {
+    const DocumentSlot& slot = slots_[ordinal];
+    matched_documents.push_back({slot.id, relevance, slot.rating});
   }
   return matched_documents;
 }
@@ -224,53 +673,74 @@ std::vector<Document> SearchServer::FindAllDocuments(
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindAllDocuments(
     const std::execution::parallel_policy&, const Query& query,
-    DocumentPredicate document_predicate) const {
+    DocumentPredicate document_predicate, const QueryContext& context) const {
       
-  ConcurrentMap<int, double> document_to_relevance(BUCKET_COUNT);
+  ConcurrentMap<int, double> ordinal_to_relevance(BUCKET_COUNT);
+  const bool is_stopped = !BudgetMeter(context.budget).Check();
+  const auto plus_words = is_stopped ? std::vector<std::string_view>{}
+                                     : GetScanOrder(query, context);
+  // Each task takes the next word in scan order rather than its own, so
+  // the rarest words are started first however the tasks are scheduled
+  std::atomic<size_t> next_word = 0;
 
   for_each(
-      std::execution::par, query.plus_words.cbegin(),
-      query.plus_words.cend(), [this, &document_predicate,
-      &document_to_relevance](const auto& word) {
-        if (word_to_document_freqs_.count(word) == 0) {
+      std::execution::par, plus_words.cbegin(),
+      plus_words.cend(), [this, &query, &document_predicate, &context,
+      &ordinal_to_relevance, &plus_words, &next_word](const auto&) {
+        const std::string_view word = plus_words[next_word.fetch_add(1)];
+        if (word_to_document_freqs_.count(word) == 0 ||
+            (context.budget != nullptr && context.budget->IsExhausted())) {
           return;
         }
         const double inverse_document_freq =
-            ComputeWordInverseDocumentFreq(word);
+            ComputeWordInverseDocumentFreq(word, context) *
+            query.GetWordWeight(word);
 
-        for (const auto [document_id, term_freq] :
+        BudgetMeter meter(context.budget);
+        for (const auto [ordinal, term_freq] :
              word_to_document_freqs_.at(word)) {
-          const auto& document_data = documents_.at(document_id);
-
-          if (document_predicate(document_id, document_data.status,
-                                 document_data.rating)) {
-            document_to_relevance[document_id].ref_to_value +=
+          if (!meter.Tick()) {
+            return;
+          }
+          if (IsAccepted(document_predicate, ordinal)) {
+            ordinal_to_relevance[ordinal].ref_to_value +=
                 term_freq * inverse_document_freq;
           }
         }
+        meter.Check();
         return;
       });
 
   for_each(
       std::execution::par, query.minus_words.cbegin(),
-      query.minus_words.cend(), [this, &document_to_relevance](const auto&
-      word) {
+      query.minus_words.cend(), [this, &context, &ordinal_to_relevance](
+      const auto& word) {
         if (word_to_document_freqs_.count(word) == 0) {
           return;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word))
+        BudgetMeter meter(context.budget);
+        for (const auto [ordinal, _] : word_to_document_freqs_.at(word))
         {
-          document_to_relevance.Erase(document_id);
+          if (!meter.Tick()) {
+            return;
+          }
+          ordinal_to_relevance.Erase(ordinal);
         }
         return;
       });
 
+  auto ordinary_map = ordinal_to_relevance.BuildOrdinaryMap();
+  if (context.budget != nullptr && context.budget->IsExhausted()) {
+    ApplyMinusWordsToCandidates(query, ordinary_map);
+  }
+  ApplyMinusPrefixes(query, ordinary_map);
+  ApplyPositionalConstraints(query, ordinary_map);
+
   std::vector<Document> matched_documents;
 
-  for (const auto [document_id, relevance] :
-       document_to_relevance.BuildOrdinaryMap()) {
-    matched_documents.push_back(
-        {document_id, relevance, documents_.at(document_id).rating});
+  for (const auto [ordinal, relevance] : ordinary_map) {
+    const DocumentSlot& slot = slots_[ordinal];
+    matched_documents.push_back({slot.id, relevance, slot.rating});
   }
 
   return matched_documents;
@@ -0,0 +1,309 @@
+#include "sharded_search_server.h"
+
+#include <algorithm>
+#include <exception>
+#include <execution>
+#include <future>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "string_processing.h"
+
+ShardedSearchServer::ShardedSearchServer(const std::string& stop_words,
+                                         size_t shard_count)
+    : ShardedSearchServer(SplitIntoWords(stop_words), shard_count) {}
+
+ShardedSearchServer::ShardedSearchServer(std::string_view stop_words,
+                                         size_t shard_count)
+    : ShardedSearchServer(SplitIntoWords(stop_words), shard_count) {}
+
+void ShardedSearchServer::EnablePositionalIndex(double proximity_weight) {
+  using namespace std::literals;
+  // Checked here so that no shard is left switched on alone
+  if (!ids_.empty()) {
+    throw std::logic_error("POSITIONS_AFTER_ADD"s);
+  }
+  for (SearchServer& shard : shards_) {
+    shard.EnablePositionalIndex(proximity_weight);
+  }
+}
+
+void ShardedSearchServer::CheckShardCount() const {
+  using namespace std::literals;
+  if (shards_.empty()) {
+    throw std::invalid_argument("ZERO_SHARDS"s);
+  }
+}
+
+SearchServer& ShardedSearchServer::GetShardFor(int document_id) {
+  return shards_[MixHash(static_cast<uint64_t>(document_id)) % shards_.size()];
+}
+
+const SearchServer& ShardedSearchServer::GetShardFor(int document_id) const {
+  return shards_[MixHash(static_cast<uint64_t>(document_id)) % shards_.size()];
+}
+
+void ShardedSearchServer::AddDocument(int document_id,
+                                      std::string_view document,
+                                      DocumentStatus status,
+                                      const std::vector<int>& ratings) {
+  GetShardFor(document_id).AddDocument(document_id, document, status, ratings);
+  ids_.insert(document_id);
+}
+
+void ShardedSearchServer::AddDocuments(
+    const std::vector<DocumentToAdd>& documents) {
+  std::map<const SearchServer*, std::vector<const DocumentToAdd*>> batches;
+  for (const DocumentToAdd& document : documents) {
+    batches[&GetShardFor(document.id)].push_back(&document);
+  }
+
+  struct ShardResult {
+    std::vector<int> added_ids;
+    std::exception_ptr error;
+  };
+  std::vector<std::future<ShardResult>> results;
+  for (SearchServer& shard : shards_) {
+    const auto it = batches.find(&shard);
+    if (it == batches.end()) {
+      continue;
+    }
+    results.push_back(std::async(
+        std::launch::async, [&shard, &batch = it->second]() {
+          ShardResult result;
+          try {
+            for (const DocumentToAdd* document : batch) {
+              shard.AddDocument(document->id, document->text,
+                                document->status, document->ratings);
+              result.added_ids.push_back(document->id);
+            }
+          } catch (...) {
+            result.error = std::current_exception();
+          }
+          return result;
+        }));
+  }
+
+  // A failing document stops its own shard only; ids added anywhere stay
+  std::exception_ptr first_error;
+  for (auto& future : results) {
+    ShardResult result = future.get();
+    ids_.insert(result.added_ids.cbegin(), result.added_ids.cend());
+    if (result.error && !first_error) {
+      first_error = result.error;
+    }
+  }
+  if (first_error) {
+    std::rethrow_exception(first_error);
+  }
+}
+
+void ShardedSearchServer::RemoveDocument(
+    const std::execution::sequenced_policy& policy, int document_id) {
+  GetShardFor(document_id).RemoveDocument(policy, document_id);
+  ids_.erase(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(
+    const std::execution::parallel_policy& policy, int document_id) {
+  GetShardFor(document_id).RemoveDocument(policy, document_id);
+  ids_.erase(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+  RemoveDocument(std::execution::seq, document_id);
+}
+
+template <typename ExecutionPolicy>
+RemovalStats ShardedSearchServer::RemoveDocumentsInternal(
+    const ExecutionPolicy& policy, const std::vector<int>& document_ids) {
+  std::vector<std::vector<int>> shard_ids(shards_.size());
+  for (const int document_id : document_ids) {
+    shard_ids[&GetShardFor(document_id) - shards_.data()].push_back(
+        document_id);
+  }
+
+  std::vector<size_t> indexes(shards_.size());
+  std::iota(indexes.begin(), indexes.end(), 0);
+  std::vector<RemovalStats> shard_stats(shards_.size());
+  std::transform(policy, indexes.cbegin(), indexes.cend(), shard_stats.begin(),
+                 [this, &shard_ids](size_t i) {
+                   return shards_[i].RemoveDocuments(std::execution::seq,
+                                                     shard_ids[i]);
+                 });
+
+  RemovalStats stats;
+  for (const RemovalStats& shard : shard_stats) {
+    stats.removed_documents += shard.removed_documents;
+    stats.removed_postings += shard.removed_postings;
+    stats.removed_terms += shard.removed_terms;
+    stats.reclaimed_bytes += shard.reclaimed_bytes;
+  }
+  for (const int document_id : document_ids) {
+    ids_.erase(document_id);
+  }
+  return stats;
+}
+
+RemovalStats ShardedSearchServer::RemoveDocuments(
+    const std::execution::sequenced_policy& policy,
+    const std::vector<int>& document_ids) {
+  return RemoveDocumentsInternal(policy, document_ids);
+}
+
+RemovalStats ShardedSearchServer::RemoveDocuments(
+    const std::execution::parallel_policy& policy,
+    const std::vector<int>& document_ids) {
+  return RemoveDocumentsInternal(policy, document_ids);
+}
+
+RemovalStats ShardedSearchServer::RemoveDocuments(
+    const std::vector<int>& document_ids) {
+  return RemoveDocuments(std::execution::seq, document_ids);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(
+    std::string_view raw_query, DocumentStatus status) const {
+  return FindTopDocuments(std::execution::seq, raw_query, status);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(
+    std::string_view raw_query) const {
+  return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+QueryCursor ShardedSearchServer::OpenCursor(std::string_view raw_query,
+                                            DocumentStatus status) const {
+  return OpenCursor(std::execution::seq, raw_query, status);
+}
+
+QueryCursor ShardedSearchServer::OpenCursor(std::string_view raw_query) const {
+  return OpenCursor(raw_query, DocumentStatus::ACTUAL);
+}
+
+size_t ShardedSearchServer::GetDocumentCount() const { return ids_.size(); }
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+ShardedSearchServer::MatchDocument(
+    const std::execution::sequenced_policy& policy, std::string_view raw_query,
+    int document_id) const {
+  return GetShardFor(document_id).MatchDocument(policy, raw_query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+ShardedSearchServer::MatchDocument(
+    const std::execution::parallel_policy& policy, std::string_view raw_query,
+    int document_id) const {
+  return GetShardFor(document_id).MatchDocument(policy, raw_query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+ShardedSearchServer::MatchDocument(std::string_view raw_query,
+                                   int document_id) const {
+  return MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+template <typename ExecutionPolicy>
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+ShardedSearchServer::MatchDocumentsInternal(
+    const ExecutionPolicy& policy, std::string_view raw_query,
+    const std::vector<int>& document_ids) const {
+  using namespace std::literals;
+  // Checked up front, like SearchServer, so no shard does work in vain
+  if (std::any_of(document_ids.cbegin(), document_ids.cend(),
+                  [this](int document_id) {
+                    return ids_.count(document_id) == 0;
+                  })) {
+    throw std::out_of_range("id is out of range"s);
+  }
+
+  std::vector<std::vector<int>> shard_ids(shards_.size());
+  std::vector<std::vector<size_t>> shard_positions(shards_.size());
+  for (size_t i = 0; i < document_ids.size(); ++i) {
+    const size_t shard = &GetShardFor(document_ids[i]) - shards_.data();
+    shard_ids[shard].push_back(document_ids[i]);
+    shard_positions[shard].push_back(i);
+  }
+
+  std::vector<size_t> indexes(shards_.size());
+  std::iota(indexes.begin(), indexes.end(), 0);
+  std::vector<std::vector<std::tuple<std::vector<std::string_view>,
+                                     DocumentStatus>>>
+      shard_results(shards_.size());
+  std::transform(policy, indexes.cbegin(), indexes.cend(),
+                 shard_results.begin(),
+                 [this, raw_query, &shard_ids](size_t i) {
+                   return shards_[i].MatchDocuments(std::execution::seq,
+                                                    raw_query, shard_ids[i]);
+                 });
+
+  std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+      result(document_ids.size());
+  for (size_t shard = 0; shard < shards_.size(); ++shard) {
+    for (size_t i = 0; i < shard_positions[shard].size(); ++i) {
+      result[shard_positions[shard][i]] = std::move(shard_results[shard][i]);
+    }
+  }
+  return result;
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+ShardedSearchServer::MatchDocuments(
+    const std::execution::sequenced_policy& policy, std::string_view raw_query,
+    const std::vector<int>& document_ids) const {
+  return MatchDocumentsInternal(policy, raw_query, document_ids);
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+ShardedSearchServer::MatchDocuments(
+    const std::execution::parallel_policy& policy, std::string_view raw_query,
+    const std::vector<int>& document_ids) const {
+  return MatchDocumentsInternal(policy, raw_query, document_ids);
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+ShardedSearchServer::MatchDocuments(
+    std::string_view raw_query, const std::vector<int>& document_ids) const {
+  return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
+const std::map<std::string_view, double>&
+ShardedSearchServer::GetWordFrequencies(int document_id) const {
+  return GetShardFor(document_id).GetWordFrequencies(document_id);
+}
+
+CollectionStats ShardedSearchServer::GetCollectionStats(
+    std::string_view raw_query) const {
+  CollectionStats stats;
+  for (const SearchServer& shard : shards_) {
+    stats += shard.GetCollectionStats(raw_query);
+  }
+  return stats;
+}
+
+MemoryStats ShardedSearchServer::GetMemoryStats() const {
+  MemoryStats stats;
+  for (const SearchServer& shard : shards_) {
+    stats += shard.GetMemoryStats();
+  }
+  return stats;
+}
+
+size_t ShardedSearchServer::GetShardCount() const { return shards_.size(); }
+
+const SearchServer& ShardedSearchServer::GetShard(size_t index) const {
+  return shards_.at(index);
+}
+
+std::set<int>::const_iterator ShardedSearchServer::begin() const {
+  return ids_.cbegin();
+}
+
+std::set<int>::const_iterator ShardedSearchServer::end() const {
+  return ids_.cend();
+}
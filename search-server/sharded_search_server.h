@@ -0,0 +1,263 @@
+#pragma once
+
+#include <algorithm>
+#include <execution>
+#include <set>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "document.h"
+#include "query_cursor.h"
+#include "search_server.h"
+#include "string_processing.h"
+
+// Hash-partitions documents across independent SearchServer shards.
+// Queries fan out to every shard with collection statistics summed over
+// all of them, so relevance and ranking match a single SearchServer.
+class ShardedSearchServer {
+ public:
+  struct DocumentToAdd {
+    int id;
+    std::string_view text;
+    DocumentStatus status;
+    std::vector<int> ratings;
+  };
+
+  template <typename StringContainer>
+  ShardedSearchServer(const StringContainer& stop_words, size_t shard_count);
+  ShardedSearchServer(const std::string& stop_words, size_t shard_count);
+  ShardedSearchServer(std::string_view stop_words, size_t shard_count);
+
+  // As SearchServer::EnablePositionalIndex, for every shard; must be called
+  // before the first AddDocument
+  void EnablePositionalIndex(double proximity_weight = 0.0);
+
+  void AddDocument(int document_id, std::string_view document,
+                   DocumentStatus status, const std::vector<int>& ratings);
+
+  // Every shard indexes its part of the batch on its own thread
+  void AddDocuments(const std::vector<DocumentToAdd>& documents);
+
+  void RemoveDocument(const std::execution::sequenced_policy&, int document_id);
+  void RemoveDocument(const std::execution::parallel_policy&, int document_id);
+  void RemoveDocument(int document_id);
+
+  RemovalStats RemoveDocuments(const std::execution::sequenced_policy&,
+                               const std::vector<int>& document_ids);
+  RemovalStats RemoveDocuments(const std::execution::parallel_policy&,
+                               const std::vector<int>& document_ids);
+  RemovalStats RemoveDocuments(const std::vector<int>& document_ids);
+
+  template <typename ExecutionPolicy, typename DocumentPredicate>
+  std::vector<Document> FindTopDocuments(
+      const ExecutionPolicy& policy, std::string_view raw_query,
+      DocumentPredicate document_predicate) const;
+
+  template <typename ExecutionPolicy>
+  std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
+                                         std::string_view raw_query,
+                                         DocumentStatus status) const;
+
+  template <typename ExecutionPolicy>
+  std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
+                                         std::string_view raw_query) const;
+
+  template <typename DocumentPredicate>
+  std::vector<Document> FindTopDocuments(
+      std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+  std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                         DocumentStatus status) const;
+
+  std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+  // The whole match set ranked with global IDF, as from a single server
+  template <typename ExecutionPolicy, typename DocumentPredicate>
+  QueryCursor OpenCursor(const ExecutionPolicy& policy,
+                         std::string_view raw_query,
+                         DocumentPredicate document_predicate) const;
+
+  template <typename ExecutionPolicy>
+  QueryCursor OpenCursor(const ExecutionPolicy& policy,
+                         std::string_view raw_query,
+                         DocumentStatus status) const;
+
+  template <typename ExecutionPolicy>
+  QueryCursor OpenCursor(const ExecutionPolicy& policy,
+                         std::string_view raw_query) const;
+
+  template <typename DocumentPredicate>
+  QueryCursor OpenCursor(std::string_view raw_query,
+                         DocumentPredicate document_predicate) const;
+
+  QueryCursor OpenCursor(std::string_view raw_query,
+                         DocumentStatus status) const;
+
+  QueryCursor OpenCursor(std::string_view raw_query) const;
+
+  size_t GetDocumentCount() const;
+
+  std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(
+      const std::execution::sequenced_policy&, std::string_view raw_query,
+      int document_id) const;
+
+  std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(
+      const std::execution::parallel_policy&, std::string_view raw_query,
+      int document_id) const;
+
+  std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(
+      std::string_view raw_query, int document_id) const;
+
+  // Each shard matches its own documents; results keep the order of ids
+  std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+  MatchDocuments(const std::execution::sequenced_policy&,
+                 std::string_view raw_query,
+                 const std::vector<int>& document_ids) const;
+
+  std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+  MatchDocuments(const std::execution::parallel_policy&,
+                 std::string_view raw_query,
+                 const std::vector<int>& document_ids) const;
+
+  std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+  MatchDocuments(std::string_view raw_query,
+                 const std::vector<int>& document_ids) const;
+
+  const std::map<std::string_view, double>& GetWordFrequencies(
+      int document_id) const;
+
+  CollectionStats GetCollectionStats(std::string_view raw_query) const;
+
+  // Sum over the shards; a term held by several shards is counted in each
+  MemoryStats GetMemoryStats() const;
+
+  size_t GetShardCount() const;
+  const SearchServer& GetShard(size_t index) const;
+
+  std::set<int>::const_iterator begin() const;
+  std::set<int>::const_iterator end() const;
+
+ private:
+  std::vector<SearchServer> shards_;
+  std::set<int> ids_;
+
+  void CheckShardCount() const;
+
+  SearchServer& GetShardFor(int document_id);
+  const SearchServer& GetShardFor(int document_id) const;
+
+  template <typename ExecutionPolicy>
+  RemovalStats RemoveDocumentsInternal(const ExecutionPolicy& policy,
+                                       const std::vector<int>& document_ids);
+
+  template <typename ExecutionPolicy>
+  std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+  MatchDocumentsInternal(const ExecutionPolicy& policy,
+                         std::string_view raw_query,
+                         const std::vector<int>& document_ids) const;
+};
+
+template <typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(const StringContainer& stop_words,
+                                         size_t shard_count) {
+  shards_.reserve(shard_count);
+  for (size_t i = 0; i < shard_count; ++i) {
+    shards_.emplace_back(stop_words);
+  }
+  CheckShardCount();
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(
+    const ExecutionPolicy& policy, std::string_view raw_query,
+    DocumentPredicate document_predicate) const {
+  const CollectionStats stats = GetCollectionStats(raw_query);
+
+  // Each shard's top is ranked with global IDF, so the global top is
+  // among their union
+  std::vector<std::vector<Document>> shard_tops(shards_.size());
+  std::transform(policy, shards_.cbegin(), shards_.cend(), shard_tops.begin(),
+                 [raw_query, &document_predicate,
+                  &stats](const SearchServer& shard) {
+                   return shard.FindTopDocuments(std::execution::seq,
+                                                 raw_query, document_predicate,
+                                                 stats);
+                 });
+
+  std::vector<Document> matched_documents;
+  for (const auto& shard_top : shard_tops) {
+    matched_documents.insert(matched_documents.end(), shard_top.cbegin(),
+                             shard_top.cend());
+  }
+  const size_t result_count =
+      std::min(matched_documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+  std::partial_sort(matched_documents.begin(),
+                    matched_documents.begin() + result_count,
+                    matched_documents.end(), IsMoreRelevant);
+  matched_documents.resize(result_count);
+  return matched_documents;
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(
+    const ExecutionPolicy& policy, std::string_view raw_query,
+    DocumentStatus status) const {
+  return FindTopDocuments(policy, raw_query, DocumentFilter{status});
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(
+    const ExecutionPolicy& policy, std::string_view raw_query) const {
+  return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(
+    std::string_view raw_query, DocumentPredicate document_predicate) const {
+  return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+QueryCursor ShardedSearchServer::OpenCursor(
+    const ExecutionPolicy& policy, std::string_view raw_query,
+    DocumentPredicate document_predicate) const {
+  const CollectionStats stats = GetCollectionStats(raw_query);
+  std::vector<std::vector<Document>> shard_matches(shards_.size());
+  std::transform(policy, shards_.cbegin(), shards_.cend(),
+                 shard_matches.begin(),
+                 [raw_query, &document_predicate,
+                  &stats](const SearchServer& shard) {
+                   return shard
+                       .OpenCursor(std::execution::seq, raw_query,
+                                   document_predicate, stats)
+                       .TakeRemaining();
+                 });
+
+  std::vector<Document> matched_documents;
+  for (const auto& matches : shard_matches) {
+    matched_documents.insert(matched_documents.end(), matches.cbegin(),
+                             matches.cend());
+  }
+  return QueryCursor(std::move(matched_documents));
+}
+
+template <typename ExecutionPolicy>
+QueryCursor ShardedSearchServer::OpenCursor(const ExecutionPolicy& policy,
+                                            std::string_view raw_query,
+                                            DocumentStatus status) const {
+  return OpenCursor(policy, raw_query, DocumentFilter{status});
+}
+
+template <typename ExecutionPolicy>
+QueryCursor ShardedSearchServer::OpenCursor(const ExecutionPolicy& policy,
+                                            std::string_view raw_query) const {
+  return OpenCursor(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename DocumentPredicate>
+QueryCursor ShardedSearchServer::OpenCursor(
+    std::string_view raw_query, DocumentPredicate document_predicate) const {
+  return OpenCursor(std::execution::seq, raw_query, document_predicate);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+constexpr size_t SPSC_SLEEP_PERIOD = 16ull;
+
+// Bounded lock-free queue for exactly one producer and one consumer
+// thread. Push waits while the queue is full, which is what throttles a
+// stage that runs ahead of the one after it.
+template <typename T>
+class SpscQueue {
+ public:
+  // Capacity is rounded up to a power of two
+  explicit SpscQueue(size_t capacity) : slots_(RoundUpToPowerOfTwo(capacity)) {}
+
+  // Returns false if the consumer has closed the queue
+  bool Push(T value) {
+    if (is_closed_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    for (size_t attempt = 1; tail - head_cache_ == slots_.size(); ++attempt) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ != slots_.size()) {
+        break;
+      }
+      if (is_closed_.load(std::memory_order_acquire)) {
+        return false;
+      }
+      ++full_waits_;
+      Wait(attempt);
+    }
+    slots_[tail & (slots_.size() - 1)] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Waits for the next value; empty once the queue is closed and drained
+  std::optional<T> Pop() {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    for (size_t attempt = 1; head == tail_cache_; ++attempt) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head != tail_cache_) {
+        break;
+      }
+      if (is_closed_.load(std::memory_order_acquire)) {
+        // Values pushed right before Close
+        tail_cache_ = tail_.load(std::memory_order_acquire);
+        if (head == tail_cache_) {
+          return std::nullopt;
+        }
+        break;
+      }
+      Wait(attempt);
+    }
+    std::optional<T> value = std::move(slots_[head & (slots_.size() - 1)]);
+    head_.store(head + 1, std::memory_order_release);
+    return value;
+  }
+
+  // Either side may close: the producer when it is done, the consumer
+  // when it gives up
+  void Close() { is_closed_.store(true, std::memory_order_release); }
+
+  // Times the producer found the queue full
+  size_t GetFullWaitCount() const { return full_waits_; }
+
+ private:
+  // Yields first; a side that keeps waiting is far behind or ahead, so it
+  // sleeps and leaves the core to the stage that has work
+  static void Wait(size_t attempt) {
+    if (attempt % SPSC_SLEEP_PERIOD != 0) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+
+  static size_t RoundUpToPowerOfTwo(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+      size *= 2;
+    }
+    return size;
+  }
+
+  std::vector<T> slots_;
+  std::atomic<bool> is_closed_ = false;
+  // Indexes grow without wrapping; each side caches the other's index and
+  // owns a separate cache line
+  alignas(64) std::atomic<size_t> head_ = 0;
+  size_t tail_cache_ = 0;
+  alignas(64) std::atomic<size_t> tail_ = 0;
+  size_t head_cache_ = 0;
+  size_t full_waits_ = 0;
+};
@@ -1,3 +1,6 @@
+#include "string_processing.h"
+
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -13,4 +16,24 @@ std::vector<std::string_view> SplitIntoWords(std::string_view str) {
     }
 
     return result;
-}
\ No newline at end of file
+}
+
+uint64_t HashWord(std::string_view word) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ull;
+  for (const char c : word) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return MixHash(hash);
+}
+
+uint64_t MixHash(uint64_t x) {
+  // splitmix64 finalizer
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <set>
 #include <string>
 #include <string_view>
@@ -7,6 +8,10 @@
 
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
 
+// Stable across runs and platforms, unlike std::hash
+uint64_t HashWord(std::string_view word);
+uint64_t MixHash(uint64_t x);
+
 template <typename StringContainer>
 std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(
     const StringContainer& strings) {
@@ -0,0 +1,244 @@
+#include "term_trie.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "memory_usage.h"
+
+namespace {
+
+// Length of a UTF-8 sequence judging by its first byte; 1 when invalid
+size_t GetSequenceLength(uint8_t lead) {
+  if (lead >= 0xc0 && lead < 0xe0) {
+    return 2;
+  }
+  if (lead >= 0xe0 && lead < 0xf0) {
+    return 3;
+  }
+  if (lead >= 0xf0 && lead < 0xf8) {
+    return 4;
+  }
+  return 1;
+}
+
+// True while the bytes can still become one valid code point
+bool IsUnfinishedSequence(std::string_view bytes) {
+  if (bytes.empty() ||
+      bytes.size() >= GetSequenceLength(static_cast<uint8_t>(bytes[0]))) {
+    return false;
+  }
+  return std::all_of(bytes.begin() + 1, bytes.end(), [](char c) {
+    return (static_cast<uint8_t>(c) & 0xc0) == 0x80;
+  });
+}
+
+// Steps through the code points at the front of bytes the way DecodeUtf8
+// reads them, leaving an unfinished sequence unless at_end. Returns the
+// depth reached, or 0 with is_alive false once nothing can match.
+size_t StepThrough(LevenshteinDfa& dfa, std::vector<uint32_t>& states,
+                   size_t depth, std::string& bytes, bool at_end,
+                   bool& is_alive) {
+  size_t pos = 0;
+  is_alive = true;
+  while (pos < bytes.size() &&
+         (at_end || !IsUnfinishedSequence(std::string_view(bytes).substr(pos)))) {
+    const char32_t c = DecodeUtf8(bytes, pos);
+    if (states.size() == depth + 1) {
+      states.push_back(0);
+    }
+    states[depth + 1] = dfa.Step(states[depth], c);
+    ++depth;
+    if (!dfa.CanMatch(states[depth])) {
+      is_alive = false;
+      break;
+    }
+  }
+  bytes.erase(0, pos);
+  return depth;
+}
+
+}  // namespace
+
+TermTrie::TermTrie() : nodes_(1) {}
+
+TermTrie::TermTrie(const std::vector<std::string_view>& sorted_terms)
+    : nodes_(1), terms_(sorted_terms) {
+  // Breadth-first, so that the children of each node are appended together
+  struct Pending {
+    uint32_t node;
+    size_t begin;
+    size_t end;
+    size_t depth;
+  };
+  std::deque<Pending> queue{{0, 0, terms_.size(), 0}};
+  while (!queue.empty()) {
+    const auto [node_index, begin, end, depth] = queue.front();
+    queue.pop_front();
+    size_t i = begin;
+    // Sorted, so a term equal to the prefix comes first
+    if (i < end && terms_[i].size() == depth) {
+      nodes_[node_index].term = static_cast<uint32_t>(i);
+      ++i;
+    }
+    nodes_[node_index].first_child = static_cast<uint32_t>(nodes_.size());
+    while (i < end) {
+      const char label = terms_[i][depth];
+      size_t group_end = i + 1;
+      while (group_end < end && terms_[group_end][depth] == label) {
+        ++group_end;
+      }
+      Node child;
+      child.label = static_cast<uint8_t>(label);
+      queue.push_back(
+          {static_cast<uint32_t>(nodes_.size()), i, group_end, depth + 1});
+      nodes_.push_back(child);
+      ++nodes_[node_index].child_count;
+      i = group_end;
+    }
+  }
+}
+
+std::vector<std::pair<std::string_view, int>> TermTrie::FindFuzzy(
+    const LevenshteinAutomaton& automaton) const {
+  Walk walk{LevenshteinDfa(automaton), {}, {}, {}};
+  walk.states.push_back(walk.dfa.Start());
+  Visit(0, 0, walk);
+  return std::move(walk.matches);
+}
+
+void TermTrie::Visit(uint32_t node_index, size_t depth, Walk& walk) const {
+  const Node& node = nodes_[node_index];
+  if (node.term != NO_TERM) {
+    size_t final_depth = depth;
+    bool is_alive = true;
+    if (!walk.pending.empty()) {
+      // The term ends inside a sequence, so its last bytes are invalid
+      std::string bytes = walk.pending;
+      final_depth =
+          StepThrough(walk.dfa, walk.states, depth, bytes, true, is_alive);
+    }
+    if (is_alive && walk.dfa.IsMatch(walk.states[final_depth])) {
+      walk.matches.emplace_back(
+          terms_[node.term], walk.dfa.GetDistance(walk.states[final_depth]));
+    }
+  }
+  for (uint32_t child = node.first_child;
+       child < node.first_child + node.child_count; ++child) {
+    const uint8_t label = nodes_[child].label;
+    if (walk.pending.empty() && label < 0x80) {
+      if (walk.states.size() == depth + 1) {
+        walk.states.push_back(0);
+      }
+      walk.states[depth + 1] = walk.dfa.Step(walk.states[depth], label);
+      if (walk.dfa.CanMatch(walk.states[depth + 1])) {
+        Visit(child, depth + 1, walk);
+      }
+      continue;
+    }
+    const std::string saved = walk.pending;
+    walk.pending.push_back(static_cast<char>(label));
+    bool is_alive = true;
+    const size_t child_depth =
+        StepThrough(walk.dfa, walk.states, depth, walk.pending, false, is_alive);
+    if (is_alive) {
+      Visit(child, child_depth, walk);
+    }
+    walk.pending = saved;
+  }
+}
+
+size_t TermTrie::GetTermCount() const { return terms_.size(); }
+
+size_t TermTrie::GetMemoryUsage() const {
+  return BufferBytes(nodes_) + BufferBytes(terms_);
+}
+
+std::vector<std::pair<std::string_view, int>> FindFuzzy(
+    const std::set<std::string_view>& sorted_terms,
+    const LevenshteinAutomaton& automaton) {
+  // states[k] has read the first k code points of path, which end at byte
+  // offsets[k]; the next term reuses the levels it shares with path
+  std::vector<LevenshteinAutomaton::State> states{automaton.Start()};
+  std::vector<size_t> offsets{0};
+  std::string_view path;
+  size_t depth = 0;
+  LevenshteinAutomaton::State scratch = automaton.Start();
+
+  // Called with a dead states[depth]. Every child of the prefix one level
+  // up that sorts before the next viable code point is dead as well, and
+  // when there is none the search moves further up.
+  const auto seek_next_viable = [&](std::string_view term, size_t depth) {
+    for (; depth > 0; --depth) {
+      size_t pos = offsets[depth - 1];
+      const char32_t c = DecodeUtf8(term, pos);
+      if (c >= INVALID_UTF8_BASE) {
+        // Byte order and code point order disagree here; step past the
+        // prefix ending with this byte instead
+        std::string next(term.substr(0, pos));
+        while (!next.empty() && static_cast<uint8_t>(next.back()) == 0xff) {
+          next.pop_back();
+        }
+        if (next.empty()) {
+          return sorted_terms.end();
+        }
+        next.back() = static_cast<char>(static_cast<uint8_t>(next.back()) + 1);
+        return sorted_terms.lower_bound(next);
+      }
+      if (const auto viable =
+              automaton.GetNextViable(states[depth - 1], c, scratch)) {
+        std::string next(term.substr(0, offsets[depth - 1]));
+        AppendUtf8(next, *viable);
+        return sorted_terms.lower_bound(next);
+      }
+    }
+    return sorted_terms.end();
+  };
+
+  std::vector<std::pair<std::string_view, int>> matches;
+  auto it = sorted_terms.begin();
+  while (it != sorted_terms.end()) {
+    const std::string_view term = *it;
+    const size_t common = static_cast<size_t>(
+        std::mismatch(path.begin(), path.end(), term.begin(), term.end())
+            .first -
+        path.begin());
+    while (offsets[depth] > common) {
+      --depth;
+    }
+    path = term;
+
+    bool is_dead = false;
+    size_t pos = offsets[depth];
+    while (pos < term.size()) {
+      const char32_t c = DecodeUtf8(term, pos);
+      if (states.size() == depth + 1) {
+        states.push_back(states.back());
+        offsets.push_back(0);
+      }
+      automaton.Step(states[depth], c, states[depth + 1]);
+      offsets[++depth] = pos;
+      if (!automaton.CanMatch(states[depth])) {
+        is_dead = true;
+        break;
+      }
+    }
+
+    if (is_dead) {
+      it = seek_next_viable(term, depth);
+      continue;
+    }
+    if (automaton.IsMatch(states[depth])) {
+      matches.emplace_back(term, automaton.GetDistance(states[depth]));
+    }
+    ++it;
+  }
+  return matches;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "levenshtein_automaton.h"
+
+// Immutable byte trie over a sorted list of terms. The children of a node
+// sit next to each other in one array, so a walk reads a few contiguous
+// arrays instead of chasing map nodes spread over the heap.
+class TermTrie {
+ public:
+  TermTrie();
+  explicit TermTrie(const std::vector<std::string_view>& sorted_terms);
+
+  // Terms the automaton accepts, with their distances
+  std::vector<std::pair<std::string_view, int>> FindFuzzy(
+      const LevenshteinAutomaton& automaton) const;
+
+  size_t GetTermCount() const;
+  size_t GetMemoryUsage() const;
+
+ private:
+  static constexpr uint32_t NO_TERM = UINT32_MAX;
+
+  struct Node {
+    uint32_t first_child = 0;
+    uint32_t term = NO_TERM;
+    uint16_t child_count = 0;
+    uint8_t label = 0;
+  };
+
+  struct Walk {
+    LevenshteinDfa dfa;
+    // states[k] has read k code points of the current path
+    std::vector<uint32_t> states;
+    // Bytes of a code point whose last bytes are further down
+    std::string pending;
+    std::vector<std::pair<std::string_view, int>> matches;
+  };
+
+  std::vector<Node> nodes_;
+  std::vector<std::string_view> terms_;
+
+  void Visit(uint32_t node_index, size_t depth, Walk& walk) const;
+};
+
+// The same search over a sorted set, with no trie built. Seeks past every
+// prefix the automaton rejects, so it suits sets of modest size.
+std::vector<std::pair<std::string_view, int>> FindFuzzy(
+    const std::set<std::string_view>& sorted_terms,
+    const LevenshteinAutomaton& automaton);
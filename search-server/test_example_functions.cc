@@ -0,0 +1,1256 @@
+#include "test_example_functions.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <ctime>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "doc_bitmap.h"
+#include "document.h"
+#include "durable_search_server.h"
+#include "index_reordering.h"
+#include "ingestion_pipeline.h"
+#include "levenshtein_automaton.h"
+#include "numa_replicas.h"
+#include "numa_topology.h"
+#include "protocol.h"
+#include "query_cursor.h"
+#include "query_limits.h"
+#include "query_log.h"
+#include "query_service.h"
+#include "remove_duplicates.h"
+#include "request_queue.h"
+#include "search_server.h"
+#include "sharded_search_server.h"
+#include "term_trie.h"
+#include "thread_pool.h"
+#include "varint.h"
+#include "write_ahead_log.h"
+
+using namespace std;
+
+template <typename T, typename U>
+void AssertEqualImpl(const T& t, const U& u, const string& t_str,
+                     const string& u_str, const string& file,
+                     const string& func, unsigned line, const string& hint) {
+  if (t != u) {
+    cerr << boolalpha;
+    cerr << file << "("s << line << "): "s << func << ": "s;
+    cerr << "ASSERT_EQUAL("s << t_str << ", "s << u_str << ") failed: "s;
+    cerr << t << " != "s << u << "."s;
+    if (!hint.empty()) {
+      cerr << " Hint: "s << hint;
+    }
+    cerr << endl;
+    abort();
+  }
+}
+
+#define ASSERT_EQUAL(a, b) \
+  AssertEqualImpl((a), (b), #a, #b, __FILE__, __FUNCTION__, __LINE__, ""s)
+
+#define ASSERT_EQUAL_HINT(a, b, hint) \
+  AssertEqualImpl((a), (b), #a, #b, __FILE__, __FUNCTION__, __LINE__, (hint))
+
+void AssertImpl(bool value, const string& expr_str, const string& file,
+                const string& func, unsigned line, const string& hint) {
+  if (!value) {
+    cerr << file << "("s << line << "): "s << func << ": "s;
+    cerr << "ASSERT("s << expr_str << ") failed."s;
+    if (!hint.empty()) {
+      cerr << " Hint: "s << hint;
+    }
+    cerr << endl;
+    abort();
+  }
+}
+
+#define ASSERT(expr) \
+  AssertImpl(!!(expr), #expr, __FILE__, __FUNCTION__, __LINE__, ""s)
+
+#define ASSERT_HINT(expr, hint) \
+  AssertImpl(!!(expr), #expr, __FILE__, __FUNCTION__, __LINE__, (hint))
+
+template <typename TestFunc>
+void RunTestImpl(const TestFunc& func, const string& test_name) {
+  func();
+  cerr << test_name << " OK"s << endl;
+}
+
+#define RUN_TEST(func) RunTestImpl(func, #func)
+
+namespace {
+
+SearchServer MakeRemovalServer() {
+  SearchServer search_server("and with"s);
+  search_server.AddDocument(1, "white cat and fancy collar"s,
+                            DocumentStatus::ACTUAL, {8, -3});
+  search_server.AddDocument(2, "fluffy cat fluffy tail"s,
+                            DocumentStatus::ACTUAL, {7, 2, 7});
+  search_server.AddDocument(3, "groomed dog expressive eyes"s,
+                            DocumentStatus::ACTUAL, {5, -12, 2, 1});
+  return search_server;
+}
+
+SearchServer MakePositionalServer() {
+  SearchServer search_server("and with"s);
+  search_server.EnablePositionalIndex(0.5);
+  search_server.AddDocument(1, "white cat and big dog"s,
+                            DocumentStatus::ACTUAL, {1});
+  search_server.AddDocument(2, "big white cat"s, DocumentStatus::ACTUAL,
+                            {2});
+  search_server.AddDocument(3, "cat white dog"s, DocumentStatus::BANNED,
+                            {3});
+  search_server.AddDocument(4, "dogs chase the white cat"s,
+                            DocumentStatus::ACTUAL, {4});
+  return search_server;
+}
+
+bool IsSameDocuments(const vector<Document>& lhs,
+                     const vector<Document>& rhs) {
+  return equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+               [](const Document& a, const Document& b) {
+                 return a.id == b.id && a.rating == b.rating &&
+                        abs(a.relevance - b.relevance) < REL_TOLERANCE;
+               });
+}
+
+const vector<string> MATCH_QUERIES = {
+    "cat"s,
+    "big white cat"s,
+    "cat -dog"s,
+    "\"white cat\""s,
+    "\"cat white\" dog big"s,
+    "\"white cat\" -big"s,
+    "\"big dog\" white"s,
+    "big -do*"s,
+    "white ca* -dogs*"s,
+    "\"white cat\" -bi*"s,
+};
+
+// 400 documents over 150 pre* terms, so that a prefix expands past
+// MAX_PREFIX_EXPANSION and each shard alone would pick other terms
+vector<string> MakePrefixTexts() {
+  mt19937 generator(7);
+  vector<string> texts;
+  for (int id = 0; id < 400; ++id) {
+    string text;
+    for (int i = 0; i < 6; ++i) {
+      const int rank = static_cast<int>(
+          pow(generate_canonical<double, 32>(generator), 2.0) * 150);
+      text += "pre"s + to_string(rank) + " "s;
+    }
+    text += "x"s + to_string(generator() % 4);
+    texts.push_back(text);
+  }
+  return texts;
+}
+
+// 600 documents over 80 words of skewed frequency, each with its own
+// rating so that the order of results has no ties
+SearchServer MakeRandomServer() {
+  SearchServer search_server("and with"s);
+  search_server.EnablePositionalIndex(0.5);
+  mt19937 generator(11);
+  for (int id = 0; id < 600; ++id) {
+    string text;
+    const int word_count = 3 + static_cast<int>(generator() % 10);
+    for (int i = 0; i < word_count; ++i) {
+      const int rank = static_cast<int>(
+          pow(generate_canonical<double, 32>(generator), 2.0) * 80);
+      text += "w"s + to_string(rank) + " "s;
+    }
+    search_server.AddDocument(
+        id, text, id % 5 ? DocumentStatus::ACTUAL : DocumentStatus::BANNED,
+        {id});
+  }
+  for (int id = 3; id < 600; id += 7) {
+    search_server.RemoveDocument(id);
+  }
+  return search_server;
+}
+
+const vector<string> RANDOM_QUERIES = {
+    "w0"s,         "w1 w2 w3"s,      "w0 -w1"s,          "\"w0 w1\""s,
+    "\"w1 w0\" w2"s, "w1* -w0"s,   "w2 w3 -w4*"s,      "w5 w17 w33 w60"s,
+};
+
+// Every match in ranking order
+vector<Document> ReadAll(QueryCursor cursor) {
+  return cursor.NextPage(cursor.GetRemainingCount());
+}
+
+// Same documents, results, matches and term frequencies
+void CheckSameIndex(const SearchServer& actual, const SearchServer& expected) {
+  ASSERT_EQUAL(actual.GetDocumentCount(), expected.GetDocumentCount());
+  const vector<int> ids(expected.begin(), expected.end());
+  ASSERT(vector<int>(actual.begin(), actual.end()) == ids);
+  for (const string& query : RANDOM_QUERIES) {
+    for (const DocumentStatus status :
+         {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+      const vector<Document> top = expected.FindTopDocuments(query, status);
+      ASSERT_HINT(IsSameDocuments(actual.FindTopDocuments(query, status), top),
+                  query);
+      ASSERT_HINT(IsSameDocuments(actual.FindTopDocuments(execution::par,
+                                                          query, status),
+                                  top),
+                  query);
+      ASSERT_HINT(IsSameDocuments(ReadAll(actual.OpenCursor(query, status)),
+                                  ReadAll(expected.OpenCursor(query, status))),
+                  query);
+    }
+    // Answered from the status and rating bitmaps rather than per document
+    DocumentFilter filter;
+    filter.status = DocumentStatus::ACTUAL;
+    filter.min_rating = 100;
+    filter.max_rating = 400;
+    ASSERT_HINT(
+        IsSameDocuments(
+            ReadAll(actual.OpenCursor(query, filter)),
+            ReadAll(expected.OpenCursor(
+                query, [](int /*id*/, DocumentStatus status, int rating) {
+                  return status == DocumentStatus::ACTUAL && rating >= 100 &&
+                         rating <= 400;
+                }))),
+        query);
+    for (const int id : ids) {
+      ASSERT_HINT(actual.MatchDocument(query, id) ==
+                      expected.MatchDocument(query, id),
+                  query + " in "s + to_string(id));
+    }
+  }
+  for (const int id : ids) {
+    ASSERT(actual.GetWordFrequencies(id) == expected.GetWordFrequencies(id));
+  }
+}
+
+// Documents 0-299 over 30 words, then shuffled and repeated copies of
+// every tenth one under larger ids
+SearchServer MakeDuplicatesServer() {
+  SearchServer search_server("and with"s);
+  mt19937 generator(5);
+  vector<vector<string>> texts;
+  for (int id = 0; id < 300; ++id) {
+    vector<string> words;
+    const int word_count = 2 + static_cast<int>(generator() % 8);
+    for (int i = 0; i < word_count; ++i) {
+      words.push_back("d"s + to_string(generator() % 30));
+    }
+    texts.push_back(words);
+  }
+  for (int id = 0; id < 300; id += 10) {
+    vector<string> words = texts[id];
+    words.push_back(words.front());
+    shuffle(words.begin(), words.end(), generator);
+    texts.push_back(words);
+  }
+  for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+    string text;
+    for (const string& word : texts[id]) {
+      text += word + " "s;
+    }
+    search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {id});
+  }
+  return search_server;
+}
+
+string MakeTempPath(const string& name) {
+  return (filesystem::temp_directory_path() /
+          ("search_server_test_"s + name))
+      .string();
+}
+
+void WriteFile(const string& path, const string& data) {
+  ofstream(path, ios::binary | ios::trunc) << data;
+}
+
+}  // namespace
+
+// Removing documents one at a time leaves the same dictionary as removing
+// them in one batch
+void TestRemoveDocumentErasesEmptiedTerms() {
+  SearchServer batch = MakeRemovalServer();
+  batch.RemoveDocuments({1, 3});
+  const MemoryStats expected = batch.GetMemoryStats();
+
+  SearchServer seq = MakeRemovalServer();
+  seq.RemoveDocument(execution::seq, 1);
+  seq.RemoveDocument(execution::seq, 3);
+  SearchServer par = MakeRemovalServer();
+  par.RemoveDocument(execution::par, 1);
+  par.RemoveDocument(execution::par, 3);
+
+  for (const SearchServer* search_server : {&seq, &par}) {
+    const MemoryStats stats = search_server->GetMemoryStats();
+    ASSERT_EQUAL(stats.term_count, expected.term_count);
+    ASSERT_EQUAL(stats.term_dictionary_bytes, expected.term_dictionary_bytes);
+    ASSERT_EQUAL(stats.posting_count, expected.posting_count);
+    ASSERT(search_server->FindTopDocuments("dog collar"s).empty());
+    ASSERT_EQUAL(search_server->FindTopDocuments("cat"s).size(), 1u);
+  }
+  ASSERT_EQUAL(expected.term_count, 3u);
+}
+
+void TestFindTopDocumentsPolicies() {
+  const SearchServer search_server = MakePositionalServer();
+  for (const string& query : MATCH_QUERIES) {
+    for (const DocumentStatus status :
+         {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+      ASSERT_HINT(IsSameDocuments(
+                      search_server.FindTopDocuments(execution::seq, query,
+                                                     status),
+                      search_server.FindTopDocuments(execution::par, query,
+                                                     status)),
+                  query);
+    }
+  }
+}
+
+// Pages of a cursor follow the ranking of FindTopDocuments, ties broken
+// by rating and then id, and run out after a partial last page
+void TestCursorPagination() {
+  SearchServer search_server("and with"s);
+  const vector<int> tied_ids = {17, 3, 11, 5, 21, 8, 14, 1, 19, 2, 12};
+  for (const int id : tied_ids) {
+    search_server.AddDocument(id, "white cat"s, DocumentStatus::ACTUAL, {4});
+  }
+  search_server.AddDocument(40, "cat cat"s, DocumentStatus::ACTUAL, {1});
+  search_server.AddDocument(41, "cat cat"s, DocumentStatus::ACTUAL, {9});
+  for (int id = 50; id < 55; ++id) {
+    search_server.AddDocument(id, "black dog"s, DocumentStatus::ACTUAL, {4});
+  }
+  const vector<int> expected_ids = {41, 40, 1,  2,  3,  5, 8,
+                                    11, 12, 14, 17, 19, 21};
+
+  QueryCursor cursor = search_server.OpenCursor("cat"s);
+  auto pages = Paginate(cursor, 5);
+  vector<Document> paged;
+  vector<int> page_sizes;
+  for (size_t page_index = 0;; ++page_index) {
+    const auto page = pages.GetPage(page_index);
+    if (page.size() == 0) {
+      break;
+    }
+    page_sizes.push_back(page.size());
+    paged.insert(paged.end(), page.begin(), page.end());
+  }
+  ASSERT(page_sizes == vector<int>({5, 5, 3}));
+  ASSERT(cursor.IsExhausted());
+  vector<int> paged_ids;
+  for (const Document& document : paged) {
+    paged_ids.push_back(document.id);
+  }
+  ASSERT(paged_ids == expected_ids);
+
+  const vector<Document> top = search_server.FindTopDocuments("cat"s);
+  ASSERT(IsSameDocuments(top, vector<Document>(paged.begin(),
+                                               paged.begin() + top.size())));
+  // Pages already pulled stay valid; past the end there is nothing
+  ASSERT_EQUAL(pages.GetPage(0).begin()->id, 41);
+  ASSERT_EQUAL(pages.GetPage(3).size(), 0);
+  ASSERT_EQUAL(pages.GetPage(100).size(), 0);
+}
+
+void TestMatchDocumentPolicies() {
+  const SearchServer search_server = MakePositionalServer();
+  for (const string& query : MATCH_QUERIES) {
+    for (const int document_id : search_server) {
+      ASSERT_HINT(search_server.MatchDocument(execution::seq, query,
+                                              document_id) ==
+                      search_server.MatchDocument(execution::par, query,
+                                                  document_id),
+                  query + " on "s + to_string(document_id));
+    }
+  }
+  const auto [words, status] =
+      search_server.MatchDocument(execution::par, "\"cat white\" dog big"s, 2);
+  ASSERT(words.empty());
+  ASSERT(get<0>(search_server.MatchDocument(execution::par, "big -do*"s, 1))
+             .empty());
+}
+
+// Positions stay right for the remaining documents as removals compact
+// the position lists and a reorder renumbers them
+void TestPositionsAfterRemovalAndReorder() {
+  SearchServer search_server = MakePositionalServer();
+  SearchServer expected("and with"s);
+  expected.EnablePositionalIndex(0.5);
+  const vector<string> texts = {"white cat big dog"s, "big white cat"s,
+                                "cat big white dog"s, "the white cat"s};
+  for (int id = 5; id < 13; ++id) {
+    const string& text = texts[id % texts.size()];
+    search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {id});
+    if (id % 3 != 0) {
+      expected.AddDocument(id, text, DocumentStatus::ACTUAL, {id});
+    }
+  }
+  search_server.RemoveDocuments({1, 2, 3, 4, 6});
+  search_server.RemoveDocument(execution::par, 9);
+  search_server.RemoveDocument(12);
+
+  const auto check = [&expected](const SearchServer& actual) {
+    for (const string& query : MATCH_QUERIES) {
+      ASSERT_HINT(IsSameDocuments(actual.FindTopDocuments(query),
+                                  expected.FindTopDocuments(query)),
+                  query);
+    }
+  };
+  check(search_server);
+  vector<int> order(search_server.begin(), search_server.end());
+  reverse(order.begin(), order.end());
+  search_server.ReorderDocuments(order);
+  check(search_server);
+}
+
+// Without positions quotes only separate words
+void TestQuotesWithoutPositions() {
+  const SearchServer search_server = MakeRemovalServer();
+  ASSERT(IsSameDocuments(search_server.FindTopDocuments("\"white cat\""s),
+                         search_server.FindTopDocuments("white cat"s)));
+  ASSERT(IsSameDocuments(
+      search_server.FindTopDocuments("\"cat\"\"tail -collar"s),
+      search_server.FindTopDocuments("cat tail -collar"s)));
+  const auto [words, status] =
+      search_server.MatchDocument(execution::par, "\"tail fluffy\" dog"s, 2);
+  ASSERT(words == vector<string_view>({"fluffy"sv, "tail"sv}));
+
+  // Inside a word a quote separates words with positions as well
+  const SearchServer positional = MakePositionalServer();
+  for (const SearchServer* server : {&search_server, &positional}) {
+    ASSERT(IsSameDocuments(server->FindTopDocuments("cat\"dog"s),
+                           server->FindTopDocuments("cat dog"s)));
+  }
+  ASSERT(get<0>(positional.MatchDocument("white\"big"s, 1)) ==
+         get<0>(positional.MatchDocument("white big"s, 1)));
+}
+
+void TestShardedMatchesSingle() {
+  const vector<string> texts = MakePrefixTexts();
+  SearchServer single("and with"s);
+  ShardedSearchServer sharded("and with"s, 4);
+  for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+    const DocumentStatus status =
+        id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+    single.AddDocument(id, texts[id], status, {id % 7});
+    sharded.AddDocument(id, texts[id], status, {id % 7});
+  }
+  for (const string& query :
+       {"pre* x1"s, "pre1* -x2"s, "pre3 pre40 x3"s, "pre7* pre12"s}) {
+    ASSERT_HINT(IsSameDocuments(single.FindTopDocuments(query),
+                                sharded.FindTopDocuments(query)),
+                query);
+    ASSERT_HINT(IsSameDocuments(
+                    single.FindTopDocuments(execution::par, query,
+                                            DocumentStatus::BANNED),
+                    sharded.FindTopDocuments(execution::par, query,
+                                             DocumentStatus::BANNED)),
+                query);
+  }
+}
+
+void TestShardedPositionalQueries() {
+  SearchServer single("and with"s);
+  ShardedSearchServer sharded("and with"s, 3);
+  single.EnablePositionalIndex(0.5);
+  sharded.EnablePositionalIndex(0.5);
+  const vector<string> texts = {
+      "white cat and big dog"s, "big white cat"s, "cat white dog"s,
+      "dogs chase the white cat"s, "the white cat sleeps"s,
+      "a big dog and a white cat"s, "cat"s, "white dog big cat"s,
+  };
+  vector<int> ids;
+  for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+    single.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+    sharded.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+    ids.push_back(id);
+  }
+  reverse(ids.begin(), ids.end());
+
+  for (const string& query : MATCH_QUERIES) {
+    ASSERT_HINT(IsSameDocuments(single.FindTopDocuments(query),
+                                sharded.FindTopDocuments(query)),
+                query);
+    QueryCursor expected = single.OpenCursor(query);
+    QueryCursor cursor = sharded.OpenCursor(execution::par, query);
+    ASSERT_EQUAL(cursor.GetRemainingCount(), expected.GetRemainingCount());
+    while (!expected.IsExhausted()) {
+      ASSERT_HINT(IsSameDocuments(expected.NextPage(3), cursor.NextPage(3)),
+                  query);
+    }
+    ASSERT(single.MatchDocuments(query, ids) ==
+           sharded.MatchDocuments(execution::par, query, ids));
+  }
+  try {
+    sharded.EnablePositionalIndex();
+    ASSERT_HINT(false, "enabled after AddDocument"s);
+  } catch (const logic_error&) {
+  }
+}
+
+// A query cut short has still scored its rarest word, in both policies
+void TestQueryLimitsPartialResult() {
+  SearchServer search_server("and with"s);
+  for (int id = 0; id < 2000; ++id) {
+    search_server.AddDocument(
+        id, id % 500 == 7 ? "common rare"s : "common filler"s,
+        DocumentStatus::ACTUAL, {id % 10});
+  }
+  QueryLimits limits;
+  limits.max_postings = 10;
+  const auto check = [&search_server](const auto& policy,
+                                      const QueryLimits& limits) {
+    const LimitedResult result = search_server.FindTopDocuments(
+        policy, "common rare"s, DocumentStatus::ACTUAL, limits);
+    ASSERT(result.documents.size() >= 4u);
+    for (size_t i = 0; i < 4; ++i) {
+      ASSERT_EQUAL(result.documents[i].id % 500, 7);
+    }
+    return result.is_partial;
+  };
+  ASSERT(check(execution::seq, limits));
+  ASSERT(check(execution::par, limits));
+  ASSERT(!check(execution::seq, QueryLimits{}));
+  ASSERT(!check(execution::par, QueryLimits{}));
+
+  CancellationToken cancellation;
+  cancellation.Cancel();
+  limits = QueryLimits{};
+  limits.cancellation = &cancellation;
+  for (const auto& result :
+       {search_server.FindTopDocuments(execution::seq, "rare"s,
+                                       DocumentStatus::ACTUAL, limits),
+        search_server.FindTopDocuments(execution::par, "rare"s,
+                                       DocumentStatus::ACTUAL, limits)}) {
+    ASSERT(result.is_partial);
+    ASSERT(result.documents.empty());
+  }
+}
+
+void TestBoundedVarint() {
+  const vector<uint8_t> cut = {0x80, 0x80};
+  const uint8_t* pos = cut.data();
+  uint64_t value = 0;
+  ASSERT(!ReadVarint(pos, cut.data() + cut.size(), value));
+  ASSERT(pos == cut.data());
+
+  const vector<uint8_t> full = {0xac, 0x02};
+  pos = full.data();
+  ASSERT(ReadVarint(pos, full.data() + full.size(), value));
+  ASSERT_EQUAL(value, 300u);
+  ASSERT(pos == full.data() + full.size());
+}
+
+// Recovery keeps every whole record and drops a torn or corrupt last one
+void TestWriteAheadLogTail() {
+  string data;
+  for (int id = 1; id <= 3; ++id) {
+    AppendLogRecord(data, LogRecord{LogRecord::Type::ADD, id,
+                                    DocumentStatus::ACTUAL, {id, -id},
+                                    "fluffy cat number "s + to_string(id)});
+  }
+  AppendLogRecord(data, LogRecord{LogRecord::Type::REMOVE, 2,
+                                  DocumentStatus::ACTUAL, {}, {}});
+  const size_t valid_size = data.size();
+  string last;
+  AppendLogRecord(last, LogRecord{LogRecord::Type::ADD, 4,
+                                  DocumentStatus::ACTUAL, {5}, "groomed dog"s});
+
+  const string log_path = MakeTempPath("wal.log"s);
+  const string checkpoint_path = MakeTempPath("wal.checkpoint"s);
+  string corrupt = last;
+  corrupt.back() ^= 0x01;
+  for (const string& tail :
+       {last.substr(0, last.size() / 2), corrupt, last.substr(0, 3)}) {
+    WriteFile(log_path, data + tail);
+    filesystem::remove(checkpoint_path);
+
+    size_t recovered_size = 0;
+    const vector<LogRecord> records =
+        WriteAheadLog::ReadRecords(log_path, &recovered_size);
+    ASSERT_EQUAL(records.size(), 4u);
+    ASSERT_EQUAL(recovered_size, valid_size);
+    ASSERT_EQUAL(records[2].text, "fluffy cat number 3"s);
+    ASSERT(records[2].ratings == vector<int>({3, -3}));
+
+    {
+      DurableSearchServer search_server("and with"s, log_path,
+                                        checkpoint_path);
+      ASSERT_EQUAL(search_server.GetDocumentCount(), 2u);
+      ASSERT(search_server.FindTopDocuments("dog"s).empty());
+      ASSERT_EQUAL(search_server.FindTopDocuments("cat"s).size(), 2u);
+      // New records go right after the valid ones
+      search_server.AddDocument(4, "groomed dog"s, DocumentStatus::ACTUAL,
+                                {5});
+    }
+    ASSERT_EQUAL(WriteAheadLog::ReadRecords(log_path).size(), 5u);
+  }
+  filesystem::remove(log_path);
+  filesystem::remove(checkpoint_path);
+}
+
+// A document becomes visible only once its record is in the log, and
+// changes that fail validation never reach the log
+void TestDurableChangesLoggedFirst() {
+  const string log_path = MakeTempPath("durable.log"s);
+  const string checkpoint_path = MakeTempPath("durable.checkpoint"s);
+  filesystem::remove(log_path);
+  filesystem::remove(checkpoint_path);
+  {
+    DurableSearchServer search_server("and with"s, log_path, checkpoint_path);
+    atomic<bool> is_writing = true;
+    thread reader([&] {
+      while (is_writing) {
+        const vector<Document> visible =
+            search_server.FindTopDocuments("cat"s);
+        const vector<LogRecord> records = WriteAheadLog::ReadRecords(log_path);
+        for (const Document& document : visible) {
+          ASSERT_HINT(any_of(records.begin(), records.end(),
+                             [&document](const LogRecord& record) {
+                               return record.document_id == document.id;
+                             }),
+                      to_string(document.id));
+        }
+      }
+    });
+    for (int id = 0; id < 50; ++id) {
+      search_server.AddDocument(id, "cat number "s + to_string(id),
+                                DocumentStatus::ACTUAL, {id});
+    }
+    is_writing = false;
+    reader.join();
+
+    for (const int id : {-1, 7}) {
+      try {
+        search_server.AddDocument(id, "dog"s, DocumentStatus::ACTUAL, {1});
+        ASSERT_HINT(false, "the id must be rejected"s);
+      } catch (const invalid_argument&) {
+      }
+    }
+    try {
+      search_server.AddDocument(60, "bad\x01 dog"s, DocumentStatus::ACTUAL,
+                                {1});
+      ASSERT_HINT(false, "the text must be rejected"s);
+    } catch (const invalid_argument&) {
+    }
+    search_server.RemoveDocument(100);
+    search_server.RemoveDocument(3);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 49u);
+    ASSERT_EQUAL(WriteAheadLog::ReadRecords(log_path).size(), 51u);
+    search_server.Checkpoint();
+    ASSERT(WriteAheadLog::ReadRecords(log_path).empty());
+  }
+  DurableSearchServer recovered("and with"s, log_path, checkpoint_path);
+  ASSERT_EQUAL(recovered.GetDocumentCount(), 49u);
+  filesystem::remove(log_path);
+  filesystem::remove(checkpoint_path);
+}
+
+// TSV and JSONL lines: fields, escapes, status as a name or a number,
+// unknown nested fields, and what makes a line malformed
+void TestParseCorpusLine() {
+  const auto parse = [](string_view line, CorpusFormat format) {
+    TokenizedDocument document;
+    document.words.push_back({0, 1});
+    const bool is_parsed = ParseCorpusLine(line, format, document);
+    ASSERT(document.words.empty());
+    return is_parsed ? optional<TokenizedDocument>(move(document)) : nullopt;
+  };
+
+  auto document = parse("7\tBANNED\t1 2,-3\tfluffy cat"sv, CorpusFormat::TSV);
+  ASSERT(document);
+  ASSERT_EQUAL(document->id, 7);
+  ASSERT(document->status == DocumentStatus::BANNED);
+  ASSERT(document->ratings == vector<int>({1, 2, -3}));
+  ASSERT_EQUAL(document->text, "fluffy cat"s);
+  // Empty ratings; the text keeps its own tabs
+  document = parse("8\t3\t\tcat\tdog"sv, CorpusFormat::TSV);
+  ASSERT(document);
+  ASSERT(document->status == DocumentStatus::REMOVED);
+  ASSERT(document->ratings.empty());
+  ASSERT_EQUAL(document->text, "cat\tdog"s);
+  for (const string_view line :
+       {"7\tACTUAL\t1"sv, "x\tACTUAL\t1\tcat"sv, "7 \tACTUAL\t1\tcat"sv,
+        "7\tGOOD\t1\tcat"sv, "7\t4\t1\tcat"sv, "7\tACTUAL\t1 z\tcat"sv}) {
+    ASSERT_HINT(!parse(line, CorpusFormat::TSV), string(line));
+  }
+
+  document = parse(
+      R"({"id": 3, "status": "IRRELEVANT", "ratings": [4, -5], "text": "cat"})"sv,
+      CorpusFormat::JSONL);
+  ASSERT(document);
+  ASSERT_EQUAL(document->id, 3);
+  ASSERT(document->status == DocumentStatus::IRRELEVANT);
+  ASSERT(document->ratings == vector<int>({4, -5}));
+  ASSERT_EQUAL(document->text, "cat"s);
+  document = parse(
+      R"( { "text" : "dog", "meta": {"a": [1, {"b": "x]}"}], "c": null},)"
+      R"( "status": 2, "score": -1.5e3, "id": 4 } )"sv,
+      CorpusFormat::JSONL);
+  ASSERT(document);
+  ASSERT_EQUAL(document->id, 4);
+  ASSERT(document->status == DocumentStatus::BANNED);
+  ASSERT(document->ratings.empty());
+  ASSERT_EQUAL(document->text, "dog"s);
+  document = parse(
+      R"({"id": 5, "text": "a\"b\\c\/d\n\t\u0041\u00e9\u20AC\ud83d\ude00"})"sv,
+      CorpusFormat::JSONL);
+  ASSERT(document);
+  ASSERT(document->status == DocumentStatus::ACTUAL);
+  ASSERT_EQUAL(document->text,
+               "a\"b\\c/d\n\tA\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80"s);
+  for (const string_view line : {
+           R"({})"sv,
+           R"({"id": 1})"sv,
+           R"({"text": "cat"})"sv,
+           R"({"id": 1, "text": "cat"} x)"sv,
+           R"({"id": 1, "text": "cat)"sv,
+           R"({"id": 1, "text": "c\qat"})"sv,
+           R"({"id": 1, "text": "\ud83d"})"sv,
+           R"({"id": 1, "text": "\ud83dA"})"sv,
+           R"({"id": 1, "text": "\u12"})"sv,
+           R"({"id": 1, "text": "cat", "status": "GOOD"})"sv,
+           R"({"id": 1, "text": "cat", "status": 7})"sv,
+           R"({"id": 1, "text": "cat", "ratings": [1,]})"sv,
+           R"({"id": 1, "text": "cat", "meta": ]})"sv,
+           R"({"id": 1, "text": "cat", "meta": [1, 2})"sv,
+           R"({"id": "1", "text": "cat"})"sv,
+       }) {
+    ASSERT_HINT(!parse(line, CorpusFormat::JSONL), string(line));
+  }
+
+  ASSERT(DetectCorpusFormat("corpus.jsonl"s) == CorpusFormat::JSONL);
+  ASSERT(DetectCorpusFormat("corpus.json"s) == CorpusFormat::JSONL);
+  ASSERT(DetectCorpusFormat("corpus.tsv"s) == CorpusFormat::TSV);
+  ASSERT(DetectCorpusFormat("corpus"s) == CorpusFormat::TSV);
+}
+
+// Malformed lines and rejected documents are counted and skipped, and the
+// rest is indexed whatever the queue capacity
+void TestIngestCorpus() {
+  const string path = MakeTempPath("corpus.jsonl"s);
+  WriteFile(path,
+            R"({"id": 1, "ratings": [5], "text": "fluffy cat"})" "\n"
+            R"({"id": 2, "status": "BANNED", "text": "groomed dog"})" "\r\n"
+            "\n"
+            R"({"id": 3, "text": "broken)" "\n"
+            R"({"id": 1, "text": "same id"})" "\n"
+            R"({"id": -4, "text": "negative id"})" "\n"
+            R"({"id": 5, "text": "bad \u0001 symbol"})" "\n"
+            "not json\n"
+            R"({"id": 6, "ratings": [1, 2, 3], "text": "cat and dog"})" "\n"
+            R"({"id": 7, "text": "cat"})");
+  for (const size_t capacity : {1u, 1024u}) {
+    SearchServer search_server("and with"s);
+    const IngestionStats stats =
+        IngestCorpus(search_server, path, CorpusFormat::JSONL, capacity);
+    ASSERT_EQUAL(stats.indexed_documents, 4u);
+    ASSERT_EQUAL(stats.malformed_lines, 2u);
+    ASSERT_EQUAL(stats.rejected_documents, 3u);
+    ASSERT(vector<int>(search_server.begin(), search_server.end()) ==
+           vector<int>({1, 2, 6, 7}));
+    const auto [text, status, rating] = search_server.GetDocument(6);
+    ASSERT_EQUAL(text, "cat and dog"sv);
+    ASSERT(status == DocumentStatus::ACTUAL);
+    ASSERT_EQUAL(rating, 2);
+    ASSERT(get<1>(search_server.GetDocument(2)) == DocumentStatus::BANNED);
+  }
+  filesystem::remove(path);
+
+  SearchServer search_server("and with"s);
+  try {
+    IngestCorpus(search_server, path, CorpusFormat::JSONL);
+    ASSERT_HINT(false, "a missing file must throw"s);
+  } catch (const system_error&) {
+  }
+}
+
+// The one-pass union agrees with repeated |= on sparse, dense and
+// overlapping chunks
+void TestDocBitmapUnion() {
+  mt19937 generator(7);
+  vector<DocBitmap> bitmaps(30);
+  for (size_t i = 0; i < bitmaps.size(); ++i) {
+    // Every third bitmap is dense enough to turn its chunks into bitsets
+    const int count = i % 3 == 0 ? 10000 : 300;
+    for (int j = 0; j < count; ++j) {
+      bitmaps[i].Add(static_cast<int>(generator() % 200000));
+    }
+  }
+  for (const size_t used : {0u, 1u, 2u, 5u, 30u}) {
+    vector<const DocBitmap*> inputs;
+    DocBitmap expected;
+    for (size_t i = 0; i < used; ++i) {
+      // Sparse ones first, so that some chunks are merged as arrays
+      const DocBitmap& bitmap = bitmaps[(i + 1) % bitmaps.size()];
+      inputs.push_back(&bitmap);
+      expected |= bitmap;
+    }
+    const DocBitmap actual = DocBitmap::Union(inputs);
+    ASSERT_EQUAL(actual.GetCount(), expected.GetCount());
+    for (int id = 0; id < 200000; ++id) {
+      ASSERT_EQUAL_HINT(actual.Contains(id), expected.Contains(id),
+                        to_string(id));
+    }
+  }
+
+  SearchServer search_server("and with"s);
+  for (int id = 0; id < 3000; ++id) {
+    search_server.AddDocument(id, "cat"s,
+                              id % 4 ? DocumentStatus::ACTUAL
+                                     : DocumentStatus::BANNED,
+                              {id % 101 - 50});
+  }
+  DocumentFilter filter;
+  filter.status = DocumentStatus::ACTUAL;
+  filter.min_rating = -20;
+  filter.max_rating = 30;
+  const vector<Document> documents =
+      ReadAll(search_server.OpenCursor("cat"s, filter));
+  const vector<Document> expected = ReadAll(search_server.OpenCursor(
+      "cat"s, [](int /*id*/, DocumentStatus status, int rating) {
+        return status == DocumentStatus::ACTUAL && rating >= -20 &&
+               rating <= 30;
+      }));
+  ASSERT(!expected.empty());
+  ASSERT(IsSameDocuments(documents, expected));
+}
+
+// A client that sends its requests and shuts down its side still gets every
+// response before the service closes the connection
+void TestQueryServiceAnswersAfterHalfClose() {
+  SearchServer search_server("and with"s);
+  for (int id = 0; id < 100; ++id) {
+    search_server.AddDocument(id, id % 2 ? "white cat"s : "black dog"s,
+                              DocumentStatus::ACTUAL, {id});
+  }
+  ThreadPool pool(2);
+  QueryService service(search_server, pool);
+  const string path = MakeTempPath("service.sock"s);
+  service.ListenUnix(path);
+  thread loop([&service] { service.Run(); });
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT(fd >= 0);
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  path.copy(address.sun_path, path.size());
+  ASSERT(connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                 sizeof(address)) == 0);
+  const uint32_t request_count = 20;
+  string requests;
+  for (uint32_t i = 0; i < request_count; ++i) {
+    Request request;
+    request.request_id = i;
+    request.text = i % 2 ? "cat"s : "dog"s;
+    AppendRequestFrame(requests, request);
+  }
+  ASSERT_EQUAL(write(fd, requests.data(), requests.size()),
+               static_cast<ssize_t>(requests.size()));
+  shutdown(fd, SHUT_WR);
+
+  string input;
+  char buffer[4096];
+  ssize_t size = 0;
+  while ((size = read(fd, buffer, sizeof(buffer))) > 0) {
+    input.append(buffer, size);
+  }
+  close(fd);
+  service.Stop();
+  loop.join();
+  filesystem::remove(path);
+
+  vector<bool> is_answered(request_count, false);
+  string_view data = input;
+  while (const size_t frame_size = GetFrameSize(data)) {
+    const Response response = ParseResponseFrame(data.substr(0, frame_size));
+    ASSERT(response.code == ResponseCode::OK);
+    ASSERT(response.request_id < request_count);
+    ASSERT_EQUAL(response.documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+    is_answered[response.request_id] = true;
+    data.remove_prefix(frame_size);
+  }
+  ASSERT(data.empty());
+  ASSERT(all_of(is_answered.begin(), is_answered.end(),
+                [](bool answered) { return answered; }));
+}
+
+// Once stopping, the service refuses new connections and waits for the
+// queries in flight without spinning
+void TestQueryServiceStopsListening() {
+  SearchServer search_server("and with"s);
+  search_server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+  ThreadPool pool(1);
+  promise<void> release;
+  shared_future<void> released = release.get_future().share();
+  pool.Submit([released] { released.wait(); });
+  QueryService service(search_server, pool);
+  const string path = MakeTempPath("stopping.sock"s);
+  service.ListenUnix(path);
+  thread loop([&service] { service.Run(); });
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  path.copy(address.sun_path, path.size());
+  const auto connect_client = [&address] {
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT(fd >= 0);
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) != 0) {
+      close(fd);
+      return -1;
+    }
+    return fd;
+  };
+  const int fd = connect_client();
+  ASSERT(fd >= 0);
+  string request_frame;
+  Request request;
+  request.request_id = 7;
+  request.text = "cat"s;
+  AppendRequestFrame(request_frame, request);
+  ASSERT_EQUAL(write(fd, request_frame.data(), request_frame.size()),
+               static_cast<ssize_t>(request_frame.size()));
+  // The query waits in the pool behind the blocked task
+  this_thread::sleep_for(50ms);
+  service.Stop();
+  this_thread::sleep_for(50ms);
+
+  const int late_fd = connect_client();
+  ASSERT_HINT(late_fd < 0, "listener is still open after Stop"s);
+  clockid_t loop_clock;
+  ASSERT(pthread_getcpuclockid(loop.native_handle(), &loop_clock) == 0);
+  const auto cpu_time = [loop_clock] {
+    timespec time{};
+    clock_gettime(loop_clock, &time);
+    return chrono::seconds(time.tv_sec) + chrono::nanoseconds(time.tv_nsec);
+  };
+  const auto cpu_before = cpu_time();
+  this_thread::sleep_for(100ms);
+  ASSERT_HINT(cpu_time() - cpu_before < 20ms, "event loop spins"s);
+
+  release.set_value();
+  loop.join();
+  // Run returns with the connection still open, so read just one frame
+  string input;
+  char buffer[4096];
+  size_t frame_size = 0;
+  while ((frame_size = GetFrameSize(input)) == 0) {
+    const ssize_t size = read(fd, buffer, sizeof(buffer));
+    ASSERT(size > 0);
+    input.append(buffer, size);
+  }
+  close(fd);
+  filesystem::remove(path);
+
+  const Response response =
+      ParseResponseFrame(string_view(input).substr(0, frame_size));
+  ASSERT(response.code == ResponseCode::OK);
+  ASSERT_EQUAL(response.request_id, 7u);
+  ASSERT_EQUAL(response.documents.size(), 1u);
+}
+
+// The trie walk through the lazily built DFA finds exactly the terms a
+// direct run of the automaton accepts, multi-byte code points included
+void TestFuzzyMatching() {
+  SearchServer search_server("and with"s);
+  search_server.AddDocument(1, "fluffy kitten"s, DocumentStatus::ACTUAL, {1});
+  try {
+    search_server.EnableFuzzyMatching(3);
+    ASSERT_HINT(false, "three edits must be rejected"s);
+  } catch (const invalid_argument& e) {
+    ASSERT_EQUAL(string(e.what()), "INVALID_MAX_EDITS"s);
+  }
+  search_server.EnableFuzzyMatching(1);
+  ASSERT(search_server.FindTopDocuments("kittan"s).size() == 1u);
+  ASSERT(search_server.FindTopDocuments("kottan"s).empty());
+  search_server.EnableFuzzyMatching(2);
+  ASSERT(search_server.FindTopDocuments("kottan"s).size() == 1u);
+
+  const vector<string> letters = {"a"s, "b"s, "c"s, "\xc3\xa9"s,
+                                  "\xe2\x82\xac"s};
+  mt19937 generator(9);
+  set<string> unique_terms;
+  while (unique_terms.size() < 3000) {
+    string term;
+    const int length = 1 + static_cast<int>(generator() % 7);
+    for (int i = 0; i < length; ++i) {
+      term += letters[generator() % letters.size()];
+    }
+    unique_terms.insert(term);
+  }
+  const vector<string_view> terms(unique_terms.begin(), unique_terms.end());
+  const TermTrie trie(terms);
+  for (int query = 0; query < 30; ++query) {
+    const string& word = *next(unique_terms.begin(),
+                               generator() % unique_terms.size());
+    for (const int max_edits : {1, 2}) {
+      const LevenshteinAutomaton automaton(word, max_edits);
+      vector<pair<string_view, int>> expected;
+      for (const string_view term : terms) {
+        LevenshteinAutomaton::State state = automaton.Start();
+        LevenshteinAutomaton::State next_state = state;
+        for (size_t pos = 0; pos < term.size();) {
+          automaton.Step(state, DecodeUtf8(term, pos), next_state);
+          swap(state, next_state);
+        }
+        if (automaton.IsMatch(state)) {
+          expected.emplace_back(term, automaton.GetDistance(state));
+        }
+      }
+      vector<pair<string_view, int>> found = trie.FindFuzzy(automaton);
+      sort(found.begin(), found.end());
+      ASSERT_HINT(found == expected, word);
+    }
+  }
+}
+
+// A reorder changes only the internal order: every query, match and term
+// frequency stays the same, also for documents added afterwards
+void TestReorderKeepsResults() {
+  SearchServer expected = MakeRandomServer();
+  SearchServer search_server = MakeRandomServer();
+  search_server.ReorderDocuments(ComputeBisectionOrder(search_server));
+  CheckSameIndex(search_server, expected);
+
+  vector<int> order(search_server.begin(), search_server.end());
+  shuffle(order.begin(), order.end(), mt19937(3));
+  search_server.ReorderDocuments(order);
+  CheckSameIndex(search_server, expected);
+
+  for (SearchServer* server : {&search_server, &expected}) {
+    server->AddDocument(1000, "w0 w1 w2 w0"s, DocumentStatus::ACTUAL, {1000});
+    server->RemoveDocument(10);
+  }
+  CheckSameIndex(search_server, expected);
+}
+
+// A replica answers like the index it was made from, fuzzy expansions
+// included, and does not change with it afterwards
+void TestReplicaMatchesOriginal() {
+  SearchServer search_server = MakeRandomServer();
+  search_server.ReorderDocuments(ComputeBisectionOrder(search_server));
+  search_server.EnableFuzzyMatching(2);
+  const vector<string> fuzzy_queries = {"w10"s, "w1x"s, "w222"s,
+                                        "x17 -w0"s};
+  const SearchServer replica = search_server.MakeReplica();
+  CheckSameIndex(replica, search_server);
+  for (const string& query : fuzzy_queries) {
+    ASSERT_HINT(IsSameDocuments(replica.FindTopDocuments(query),
+                                search_server.FindTopDocuments(query)),
+                query);
+  }
+
+  vector<string> queries = RANDOM_QUERIES;
+  queries.insert(queries.end(), fuzzy_queries.begin(), fuzzy_queries.end());
+  // Two pretend nodes on the same CPU, so that both replicas are built
+  const int cpu = max(GetCurrentCpu(), 0);
+  NumaReplicas replicas(search_server, {{0, {cpu}}, {1, {cpu}}});
+  ASSERT_EQUAL(replicas.GetReplicaCount(), 2u);
+  const vector<vector<Document>> answers = replicas.ProcessQueries(queries);
+  for (size_t i = 0; i < queries.size(); ++i) {
+    ASSERT_HINT(IsSameDocuments(answers[i],
+                                search_server.FindTopDocuments(queries[i])),
+                queries[i]);
+  }
+
+  const SearchServer expected = replica.MakeReplica();
+  search_server.AddDocument(1000, "w0 w1 w2"s, DocumentStatus::ACTUAL, {1000});
+  search_server.RemoveDocument(1);
+  CheckSameIndex(replica, expected);
+}
+
+// What QueryLogWriter and RequestQueue write, ReadQueryLog reads back; an
+// entry cut off at the end is dropped
+void TestQueryLogRoundTrip() {
+  const string path = MakeTempPath("queries.log"s);
+  vector<QueryLogEntry> entries(4);
+  entries[0].raw_query = "white cat"s;
+  entries[0].arrival = chrono::microseconds(5);
+  entries[0].latency = chrono::microseconds(120);
+  entries[0].result_hash = 0x0123456789abcdefull;
+  entries[1].kind = QueryLogEntry::Kind::PREDICATE;
+  entries[1].status = DocumentStatus::BANNED;
+  entries[1].arrival = chrono::microseconds(3'000'000'000ll);
+  entries[1].latency = chrono::microseconds(1ll << 40);
+  entries[1].result_hash = ~0ull;
+  // Long enough for a multi-byte size
+  entries[2].raw_query = string(300, 'q');
+  entries[2].status = DocumentStatus::REMOVED;
+  entries[2].arrival = entries[1].arrival;
+  entries[3].raw_query = "last"s;
+  entries[3].arrival = entries[1].arrival + chrono::microseconds(1);
+  {
+    QueryLogWriter writer(path);
+    for (const QueryLogEntry& entry : entries) {
+      writer.Write(entry);
+    }
+  }
+  const auto check = [&entries](const vector<QueryLogEntry>& actual,
+                                size_t count) {
+    ASSERT_EQUAL(actual.size(), count);
+    for (size_t i = 0; i < count; ++i) {
+      ASSERT(actual[i].kind == entries[i].kind);
+      ASSERT(actual[i].status == entries[i].status);
+      ASSERT(actual[i].arrival == entries[i].arrival);
+      ASSERT(actual[i].latency == entries[i].latency);
+      ASSERT_EQUAL(actual[i].result_hash, entries[i].result_hash);
+      ASSERT_EQUAL(actual[i].raw_query, entries[i].raw_query);
+    }
+  };
+  check(ReadQueryLog(path), entries.size());
+
+  string data;
+  {
+    ifstream input(path, ios::binary);
+    data.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+  }
+  WriteFile(path, data.substr(0, data.size() - 2));
+  check(ReadQueryLog(path), entries.size() - 1);
+  WriteFile(path, "not a log"s + data);
+  try {
+    ReadQueryLog(path);
+    ASSERT_HINT(false, "a file without the magic must be rejected"s);
+  } catch (const invalid_argument& e) {
+    ASSERT_EQUAL(string(e.what()), "NOT_A_QUERY_LOG"s);
+  }
+
+  const SearchServer search_server = MakeRemovalServer();
+  vector<vector<Document>> results;
+  {
+    RequestQueue request_queue(search_server);
+    request_queue.StartCapture(path);
+    results.push_back(request_queue.AddFindRequest("cat"s));
+    results.push_back(
+        request_queue.AddFindRequest("white cat"s, DocumentStatus::BANNED));
+    results.push_back(request_queue.AddFindRequest(
+        "cat"s, [](int id, DocumentStatus, int) { return id % 2 == 0; }));
+    request_queue.StopCapture();
+  }
+  const vector<QueryLogEntry> captured = ReadQueryLog(path);
+  filesystem::remove(path);
+  ASSERT_EQUAL(captured.size(), results.size());
+  for (size_t i = 0; i < captured.size(); ++i) {
+    ASSERT_EQUAL(captured[i].result_hash, HashResult(results[i]));
+    ASSERT(i == 0 || captured[i].arrival >= captured[i - 1].arrival);
+  }
+  ASSERT_EQUAL(captured[1].raw_query, "white cat"s);
+  ASSERT(captured[1].status == DocumentStatus::BANNED);
+  ASSERT(captured[2].kind == QueryLogEntry::Kind::PREDICATE);
+}
+
+// The smallest id of each word set is kept, however its words are ordered
+// or repeated; equal fingerprints alone never remove a document
+void TestRemoveDuplicates() {
+  SearchServer search_server("and with"s);
+  search_server.AddDocument(5, "funny pet and nasty rat"s,
+                            DocumentStatus::ACTUAL, {1});
+  search_server.AddDocument(2, "nasty rat funny pet pet"s,
+                            DocumentStatus::BANNED, {2});
+  search_server.AddDocument(9, "rat with funny nasty pet"s,
+                            DocumentStatus::ACTUAL, {3});
+  search_server.AddDocument(3, "funny pet"s, DocumentStatus::ACTUAL, {4});
+  search_server.AddDocument(7, "and with"s, DocumentStatus::ACTUAL, {5});
+  search_server.AddDocument(4, ""s, DocumentStatus::ACTUAL, {6});
+  search_server.AddDocument(8, "with"s, DocumentStatus::ACTUAL, {7});
+  RemoveDuplicates(search_server);
+  ASSERT(vector<int>(search_server.begin(), search_server.end()) ==
+         vector<int>({2, 3, 4}));
+
+  SearchServer expected = MakeDuplicatesServer();
+  RemoveDuplicates(expected);
+  const vector<int> expected_ids(expected.begin(), expected.end());
+  // Every copy goes, the originals have smaller ids
+  ASSERT(expected_ids.back() < 300);
+  ASSERT(expected_ids.size() > 250u);
+  // Every document collides with every other
+  SearchServer colliding = MakeDuplicatesServer();
+  RemoveDuplicates(colliding, [](int /*document_id*/) {
+    return WordSetFingerprint{};
+  });
+  ASSERT(vector<int>(colliding.begin(), colliding.end()) == expected_ids);
+}
+
+// Only an identical signature passes a threshold of 1.0, so the result is
+// that of RemoveDuplicates; lower thresholds also catch near duplicates
+void TestRemoveNearDuplicates() {
+  SearchServer expected = MakeDuplicatesServer();
+  RemoveDuplicates(expected);
+  SearchServer search_server = MakeDuplicatesServer();
+  RemoveNearDuplicates(search_server, 1.0);
+  ASSERT(vector<int>(search_server.begin(), search_server.end()) ==
+         vector<int>(expected.begin(), expected.end()));
+
+  SearchServer near("and with"s);
+  string text;
+  for (int i = 0; i < 19; ++i) {
+    text += "n"s + to_string(i) + " "s;
+  }
+  near.AddDocument(1, text + "first"s, DocumentStatus::ACTUAL, {1});
+  near.AddDocument(0, "other words entirely"s,
+                            DocumentStatus::ACTUAL, {1});
+  near.AddDocument(2, text + "second"s, DocumentStatus::ACTUAL, {1});
+  RemoveNearDuplicates(near, 1.0);
+  ASSERT_EQUAL(near.GetDocumentCount(), 3u);
+  // Jaccard similarity 19/21
+  RemoveNearDuplicates(near, 0.7);
+  ASSERT(vector<int>(near.begin(), near.end()) ==
+         vector<int>({0, 1}));
+
+  try {
+    RemoveNearDuplicates(near, 0.0);
+    ASSERT_HINT(false, "the threshold must be rejected"s);
+  } catch (const invalid_argument& e) {
+    ASSERT_EQUAL(string(e.what()), "INVALID_SIMILARITY_THRESHOLD"s);
+  }
+}
+
+void TestSearchServer() {
+  RUN_TEST(TestRemoveDocumentErasesEmptiedTerms);
+  RUN_TEST(TestFindTopDocumentsPolicies);
+  RUN_TEST(TestCursorPagination);
+  RUN_TEST(TestMatchDocumentPolicies);
+  RUN_TEST(TestPositionsAfterRemovalAndReorder);
+  RUN_TEST(TestQuotesWithoutPositions);
+  RUN_TEST(TestShardedMatchesSingle);
+  RUN_TEST(TestShardedPositionalQueries);
+  RUN_TEST(TestQueryLimitsPartialResult);
+  RUN_TEST(TestBoundedVarint);
+  RUN_TEST(TestWriteAheadLogTail);
+  RUN_TEST(TestDurableChangesLoggedFirst);
+  RUN_TEST(TestQueryServiceAnswersAfterHalfClose);
+  RUN_TEST(TestQueryServiceStopsListening);
+  RUN_TEST(TestDocBitmapUnion);
+  RUN_TEST(TestFuzzyMatching);
+  RUN_TEST(TestReorderKeepsResults);
+  RUN_TEST(TestReplicaMatchesOriginal);
+  RUN_TEST(TestQueryLogRoundTrip);
+  RUN_TEST(TestRemoveDuplicates);
+  RUN_TEST(TestRemoveNearDuplicates);
+  RUN_TEST(TestParseCorpusLine);
+  RUN_TEST(TestIngestCorpus);
+}
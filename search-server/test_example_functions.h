@@ -1 +1,5 @@
-#pragma once
\ No newline at end of file
+#pragma once
+
+// Runs every behavior check; prints each test's name to std::cerr and
+// aborts on the first failed assertion
+void TestSearchServer();
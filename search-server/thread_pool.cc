@@ -0,0 +1,61 @@
+#include "thread_pool.h"
+
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+ThreadPool::ThreadPool(size_t thread_count) : ThreadPool(thread_count, {}) {}
+
+ThreadPool::ThreadPool(size_t thread_count, std::function<void()> on_start)
+    : on_start_(std::move(on_start)) {
+  using namespace std::literals;
+  if (thread_count == 0) {
+    throw std::invalid_argument("ZERO_THREADS"s);
+  }
+  threads_.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads_.emplace_back([this] { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard guard(mutex_);
+    is_stopping_ = true;
+  }
+  has_tasks_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  {
+    std::lock_guard guard(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  has_tasks_.notify_one();
+}
+
+size_t ThreadPool::GetThreadCount() const { return threads_.size(); }
+
+void ThreadPool::WorkerLoop() {
+  if (on_start_) {
+    on_start_();
+  }
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock(mutex_);
+      has_tasks_.wait(lock, [this] { return is_stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
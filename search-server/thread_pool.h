@@ -0,0 +1,34 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads executing submitted tasks in FIFO order.
+// The destructor finishes every task submitted before it.
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t thread_count);
+  // Every worker runs on_start before its first task, e.g. to pin itself
+  ThreadPool(size_t thread_count, std::function<void()> on_start);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  void Submit(std::function<void()> task);
+  size_t GetThreadCount() const;
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable has_tasks_;
+  std::deque<std::function<void()>> tasks_;
+  bool is_stopping_ = false;
+  std::function<void()> on_start_;
+  std::vector<std::thread> threads_;
+
+  void WorkerLoop();
+};
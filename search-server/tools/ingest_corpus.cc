@@ -0,0 +1,157 @@
+// Indexes a TSV or JSONL corpus with the staged ingestion pipeline and
+// compares it with reading the same file line by line on one thread.
+//
+//   ingest_corpus FILE [--format tsv|jsonl] [--queue N]
+//                 [--stop-words "and with"] [--generate N]
+//
+// With --generate, first writes N synthetic documents to FILE.
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../ingestion_pipeline.h"
+#include "../search_server.h"
+
+using namespace std;
+
+static void GenerateCorpus(const string& path, CorpusFormat format,
+                           int document_count) {
+  mt19937 generator(42);
+  // Zipf-like vocabulary: a few common words and a long tail
+  uniform_real_distribution<double> uniform(0.0, 1.0);
+  const auto random_word = [&] {
+    return "w"s + to_string(static_cast<int>(
+                      100000.0 * uniform(generator) * uniform(generator)));
+  };
+  static const char* const status_names[] = {"ACTUAL", "IRRELEVANT",
+                                             "BANNED", "REMOVED"};
+  ofstream out(path);
+  for (int id = 0; id < document_count; ++id) {
+    string text;
+    const int word_count = 20 + static_cast<int>(generator() % 200);
+    for (int i = 0; i < word_count; ++i) {
+      if (i > 0) {
+        text += ' ';
+      }
+      text += random_word();
+    }
+    const char* status = status_names[generator() % 4];
+    const int rating_count = static_cast<int>(generator() % 4);
+    vector<int> ratings;
+    for (int i = 0; i < rating_count; ++i) {
+      ratings.push_back(static_cast<int>(generator() % 21) - 10);
+    }
+    if (format == CorpusFormat::TSV) {
+      out << id << '\t' << status << '\t';
+      for (size_t i = 0; i < ratings.size(); ++i) {
+        out << (i > 0 ? " " : "") << ratings[i];
+      }
+      out << '\t' << text << '\n';
+    } else {
+      out << "{\"id\": " << id << ", \"status\": \"" << status
+          << "\", \"ratings\": [";
+      for (size_t i = 0; i < ratings.size(); ++i) {
+        out << (i > 0 ? ", " : "") << ratings[i];
+      }
+      out << "], \"text\": \"" << text << "\"}\n";
+    }
+  }
+}
+
+// One thread, getline into a fresh string, then AddDocument
+static IngestionStats IngestLineByLine(SearchServer& search_server,
+                                       const string& path,
+                                       CorpusFormat format) {
+  const auto start = chrono::steady_clock::now();
+  IngestionStats stats;
+  ifstream in(path);
+  string line;
+  TokenizedDocument document;
+  while (getline(in, line)) {
+    stats.bytes += line.size() + 1;
+    if (line.empty()) {
+      continue;
+    }
+    if (!ParseCorpusLine(line, format, document)) {
+      ++stats.malformed_lines;
+      continue;
+    }
+    try {
+      search_server.AddDocument(document.id, document.text, document.status,
+                                document.ratings);
+      ++stats.indexed_documents;
+    } catch (const invalid_argument&) {
+      ++stats.rejected_documents;
+    }
+  }
+  stats.seconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  return stats;
+}
+
+static void PrintStats(const string& name, const IngestionStats& stats) {
+  cout << name << ": "s << stats.indexed_documents << " docs in "s
+       << stats.seconds << " s, "s << stats.GetMegabytesPerSecond()
+       << " MB/s, "s << stats.GetDocumentsPerSecond() << " docs/s, "s
+       << stats.malformed_lines << " malformed, "s << stats.rejected_documents
+       << " rejected"s << endl;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    cerr << "usage: ingest_corpus FILE [--format tsv|jsonl] [--queue N] "s
+            "[--stop-words WORDS] [--generate N]"s
+         << endl;
+    return 1;
+  }
+  const string path = argv[1];
+  CorpusFormat format = DetectCorpusFormat(path);
+  size_t queue_capacity = INGESTION_QUEUE_CAPACITY;
+  string stop_words;
+  int generate_count = 0;
+  for (int i = 2; i + 1 < argc; i += 2) {
+    const string flag = argv[i];
+    const string value = argv[i + 1];
+    if (flag == "--format"s) {
+      format = value == "jsonl"s ? CorpusFormat::JSONL : CorpusFormat::TSV;
+    } else if (flag == "--queue"s) {
+      queue_capacity = static_cast<size_t>(atoi(value.c_str()));
+    } else if (flag == "--stop-words"s) {
+      stop_words = value;
+    } else if (flag == "--generate"s) {
+      generate_count = atoi(value.c_str());
+    } else {
+      cerr << "unknown flag "s << flag << endl;
+      return 1;
+    }
+  }
+
+  try {
+    if (generate_count > 0) {
+      GenerateCorpus(path, format, generate_count);
+    }
+    {
+      SearchServer search_server(stop_words);
+      PrintStats("line by line"s,
+                 IngestLineByLine(search_server, path, format));
+    }
+    SearchServer search_server(stop_words);
+    const IngestionStats stats =
+        IngestCorpus(search_server, path, format, queue_capacity);
+    PrintStats("pipeline"s, stats);
+    cout << "busy: parse "s << stats.parse_seconds << " s, tokenize "s
+         << stats.tokenize_seconds << " s, index "s << stats.index_seconds
+         << " s; stalls: parse "s << stats.parse_stalls << ", tokenize "s
+         << stats.tokenize_stalls << endl;
+    cout << search_server.GetMemoryStats() << endl;
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,241 @@
+// Drives a search_service with pipelined FIND requests and reports
+// throughput and tail latency.
+//
+//   load_generator [--unix PATH] [--port PORT] [--connections N]
+//                  [--depth N] [--seconds N] [--documents N] [--words N]
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "../latency_stats.h"
+#include "../protocol.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+struct Options {
+  string unix_path;
+  int port = -1;
+  size_t connections = 4;
+  size_t depth = 16;
+  int seconds = 10;
+  int documents = 10000;
+  int words = 1000;
+};
+
+static int Connect(const Options& options) {
+  int fd;
+  if (!options.unix_path.empty()) {
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, options.unix_path.c_str(),
+            sizeof(address.sun_path) - 1);
+    if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                          sizeof(address)) < 0) {
+      throw system_error(errno, generic_category(), "connect");
+    }
+  } else {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(options.port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                          sizeof(address)) < 0) {
+      throw system_error(errno, generic_category(), "connect");
+    }
+    const int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+  }
+  return fd;
+}
+
+static void SendAll(int fd, const string& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    const ssize_t size =
+        send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (size <= 0) {
+      throw system_error(errno, generic_category(), "send");
+    }
+    sent += static_cast<size_t>(size);
+  }
+}
+
+// Reads until at least one whole frame is buffered, returns all of them
+static vector<Response> ReceiveResponses(int fd, string& buffer) {
+  vector<Response> responses;
+  char chunk[64 << 10];
+  while (true) {
+    size_t consumed = 0;
+    size_t frame_size;
+    while ((frame_size = GetFrameSize(
+                string_view(buffer).substr(consumed))) != 0) {
+      responses.push_back(ParseResponseFrame(
+          string_view(buffer).substr(consumed, frame_size)));
+      consumed += frame_size;
+    }
+    buffer.erase(0, consumed);
+    if (!responses.empty()) {
+      return responses;
+    }
+    const ssize_t size = read(fd, chunk, sizeof(chunk));
+    if (size <= 0) {
+      throw runtime_error("connection closed"s);
+    }
+    buffer.append(chunk, static_cast<size_t>(size));
+  }
+}
+
+static string RandomText(mt19937& generator, int words, int length) {
+  uniform_int_distribution<int> word(0, words - 1);
+  string text;
+  for (int i = 0; i < length; ++i) {
+    if (i > 0) {
+      text += ' ';
+    }
+    text += "w"s + to_string(word(generator));
+  }
+  return text;
+}
+
+static void LoadDocuments(const Options& options) {
+  const int fd = Connect(options);
+  mt19937 generator(1);
+  string buffer;
+  string batch;
+  int pending = 0;
+  for (int id = 0; id < options.documents; ++id) {
+    Request request;
+    request.request_id = static_cast<uint32_t>(id);
+    request.type = RequestType::ADD;
+    request.document_id = id;
+    request.ratings = {id % 10};
+    request.text = RandomText(generator, options.words, 20);
+    AppendRequestFrame(batch, request);
+    ++pending;
+    if (pending == 256 || id + 1 == options.documents) {
+      SendAll(fd, batch);
+      batch.clear();
+      while (pending > 0) {
+        pending -= static_cast<int>(ReceiveResponses(fd, buffer).size());
+      }
+    }
+  }
+  close(fd);
+}
+
+static LatencyStats RunConnection(const Options& options,
+                                  Clock::time_point deadline,
+                                  unsigned seed) {
+  const int fd = Connect(options);
+  mt19937 generator(seed);
+  LatencyStats stats;
+  map<uint32_t, Clock::time_point> sent_at;
+  uint32_t next_id = 0;
+  string buffer;
+
+  const auto send_query = [&](string& out) {
+    Request request;
+    request.request_id = next_id++;
+    request.type = RequestType::FIND;
+    request.text = RandomText(generator, options.words, 3);
+    AppendRequestFrame(out, request);
+    sent_at[request.request_id] = Clock::now();
+  };
+
+  string out;
+  for (size_t i = 0; i < options.depth; ++i) {
+    send_query(out);
+  }
+  SendAll(fd, out);
+  while (!sent_at.empty()) {
+    out.clear();
+    for (const Response& response : ReceiveResponses(fd, buffer)) {
+      const auto it = sent_at.find(response.request_id);
+      stats.Add(Clock::now() - it->second);
+      sent_at.erase(it);
+      if (Clock::now() < deadline) {
+        send_query(out);
+      }
+    }
+    if (!out.empty()) {
+      SendAll(fd, out);
+    }
+  }
+  close(fd);
+  return stats;
+}
+
+int main(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const string flag = argv[i];
+    const string value = argv[i + 1];
+    if (flag == "--unix"s) {
+      options.unix_path = value;
+    } else if (flag == "--port"s) {
+      options.port = stoi(value);
+    } else if (flag == "--connections"s) {
+      options.connections = stoul(value);
+    } else if (flag == "--depth"s) {
+      options.depth = stoul(value);
+    } else if (flag == "--seconds"s) {
+      options.seconds = stoi(value);
+    } else if (flag == "--documents"s) {
+      options.documents = stoi(value);
+    } else if (flag == "--words"s) {
+      options.words = stoi(value);
+    } else {
+      cerr << "unknown flag "s << flag << endl;
+      return 1;
+    }
+  }
+  if (options.unix_path.empty() && options.port < 0) {
+    options.unix_path = "/tmp/search_service.sock"s;
+  }
+
+  try {
+    LoadDocuments(options);
+
+    const auto start = Clock::now();
+    const auto deadline = start + chrono::seconds(options.seconds);
+    vector<LatencyStats> results(options.connections);
+    vector<thread> threads;
+    for (size_t i = 0; i < options.connections; ++i) {
+      threads.emplace_back([&, i] {
+        results[i] = RunConnection(options, deadline,
+                                   static_cast<unsigned>(i + 2));
+      });
+    }
+    for (thread& t : threads) {
+      t.join();
+    }
+    LatencyStats total;
+    for (const LatencyStats& stats : results) {
+      total.Merge(stats);
+    }
+    total.Report(cout, Clock::now() - start);
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
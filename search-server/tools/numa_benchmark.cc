@@ -0,0 +1,161 @@
+// Compares query throughput of ProcessQueries on one shared index with
+// NumaReplicas, which answers from a replica in each NUMA node's memory.
+// --nodes splits the CPUs into that many pretend nodes, so the replica
+// path can be exercised on a single-node machine.
+//
+//   numa_benchmark [--documents N] [--words N] [--queries N] [--runs N]
+//                  [--nodes N]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../numa_replicas.h"
+#include "../numa_topology.h"
+#include "../process_queries.h"
+#include "../search_server.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+struct Options {
+  int documents = 200000;
+  int words = 20000;
+  int queries = 2000;
+  int runs = 3;
+  int nodes = 0;
+};
+
+static string RandomWord(mt19937& generator, int words) {
+  // Skewed like natural text: low ranks are much more frequent
+  uniform_real_distribution<double> uniform(0.0, 1.0);
+  const int rank = static_cast<int>(pow(uniform(generator), 3.0) * words);
+  return "w"s + to_string(rank);
+}
+
+static vector<NumaNode> SplitIntoNodes(const vector<NumaNode>& real_nodes,
+                                       int node_count) {
+  vector<int> cpus;
+  for (const NumaNode& node : real_nodes) {
+    cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.end());
+  }
+  vector<NumaNode> nodes(node_count);
+  for (int i = 0; i < node_count; ++i) {
+    nodes[i].id = i;
+  }
+  for (size_t i = 0; i < max<size_t>(cpus.size(), node_count); ++i) {
+    nodes[i % node_count].cpus.push_back(cpus[i % cpus.size()]);
+  }
+  return nodes;
+}
+
+static bool IsSameResult(const vector<vector<Document>>& lhs,
+                         const vector<vector<Document>>& rhs) {
+  return equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+               [](const vector<Document>& a, const vector<Document>& b) {
+                 return equal(a.begin(), a.end(), b.begin(), b.end(),
+                              [](const Document& x, const Document& y) {
+                                return x.id == y.id && x.rating == y.rating &&
+                                       abs(x.relevance - y.relevance) <
+                                           REL_TOLERANCE;
+                              });
+               });
+}
+
+// Best queries per second over the runs
+template <typename Process>
+static double MeasureThroughput(const Options& options,
+                                const vector<string>& queries,
+                                Process process,
+                                vector<vector<Document>>& answers) {
+  double best = 0.0;
+  for (int run = 0; run < options.runs; ++run) {
+    const auto start = Clock::now();
+    answers = process(queries);
+    const double seconds =
+        chrono::duration<double>(Clock::now() - start).count();
+    best = max(best, queries.size() / seconds);
+  }
+  return best;
+}
+
+int main(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const string flag = argv[i];
+    const int value = atoi(argv[i + 1]);
+    if (flag == "--documents"s) {
+      options.documents = value;
+    } else if (flag == "--words"s) {
+      options.words = value;
+    } else if (flag == "--queries"s) {
+      options.queries = value;
+    } else if (flag == "--runs"s) {
+      options.runs = value;
+    } else if (flag == "--nodes"s) {
+      options.nodes = value;
+    } else {
+      cerr << "unknown flag "s << flag << endl;
+      return 1;
+    }
+  }
+
+  vector<NumaNode> nodes = GetNumaNodes();
+  for (const NumaNode& node : nodes) {
+    cout << "node "s << node.id << ": "s << node.cpus.size() << " cpus"s
+         << endl;
+  }
+  if (options.nodes > 0) {
+    nodes = SplitIntoNodes(nodes, options.nodes);
+    cout << "using "s << options.nodes << " pretend nodes"s << endl;
+  }
+
+  SearchServer search_server("and with"s);
+  mt19937 generator(42);
+  for (int id = 0; id < options.documents; ++id) {
+    string text;
+    const int word_count = 10 + static_cast<int>(generator() % 40);
+    for (int i = 0; i < word_count; ++i) {
+      text += RandomWord(generator, options.words) + " "s;
+    }
+    search_server.AddDocument(id, text, DocumentStatus::ACTUAL,
+                              {static_cast<int>(generator() % 10)});
+  }
+  vector<string> queries;
+  for (int i = 0; i < options.queries; ++i) {
+    queries.push_back(RandomWord(generator, options.words) + " "s +
+                      RandomWord(generator, options.words) + " -"s +
+                      RandomWord(generator, options.words));
+  }
+
+  vector<vector<Document>> expected;
+  const double shared = MeasureThroughput(
+      options, queries,
+      [&](const vector<string>& batch) {
+        return ProcessQueries(search_server, batch);
+      },
+      expected);
+  cout << "shared index: "s << shared << " queries/s"s << endl;
+
+  const auto start = Clock::now();
+  NumaReplicas replicas(search_server, nodes);
+  const double build_seconds =
+      chrono::duration<double>(Clock::now() - start).count();
+  vector<vector<Document>> answers;
+  const double local = MeasureThroughput(
+      options, queries,
+      [&](const vector<string>& batch) {
+        return replicas.ProcessQueries(batch);
+      },
+      answers);
+  cout << "node-local replicas ("s << replicas.GetReplicaCount() << "): "s
+       << local << " queries/s, built in "s << build_seconds << " s"s
+       << (IsSameResult(expected, answers) ? ""s : ", RESULTS DIFFER"s)
+       << endl;
+  return 0;
+}
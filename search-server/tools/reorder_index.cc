@@ -0,0 +1,158 @@
+// Measures what document reordering does to posting gaps and query time.
+// Indexes a synthetic corpus of topics in random order, then renumbers it
+// by document id and by recursive graph bisection, checking that results
+// stay the same.
+//
+//   reorder_index [--documents N] [--topics N] [--queries N]
+//                 [--iterations N]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../index_reordering.h"
+#include "../search_server.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+struct Options {
+  int documents = 100000;
+  int topics = 200;
+  int queries = 2000;
+  int iterations = BISECTION_ITERATIONS;
+};
+
+// Every topic has its own vocabulary; a third of the words are shared
+static string RandomTopicWord(mt19937& generator, int topic) {
+  uniform_real_distribution<double> uniform(0.0, 1.0);
+  const int rank = static_cast<int>(300.0 * uniform(generator) *
+                                    uniform(generator));
+  if (generator() % 3 == 0) {
+    return "c"s + to_string(rank * 10);
+  }
+  return "t"s + to_string(topic) + "_"s + to_string(rank);
+}
+
+static vector<string> MakeQueries(const Options& options) {
+  mt19937 generator(7);
+  vector<string> queries;
+  for (int i = 0; i < options.queries; ++i) {
+    const int topic = static_cast<int>(generator() % options.topics);
+    queries.push_back(RandomTopicWord(generator, topic) + " "s +
+                      RandomTopicWord(generator, topic) + " "s +
+                      RandomTopicWord(generator, topic));
+  }
+  return queries;
+}
+
+// Average microseconds per query over the whole set, best of three runs
+static double MeasureLatency(const SearchServer& search_server,
+                             const vector<string>& queries,
+                             vector<vector<Document>>& results) {
+  double best = 0.0;
+  for (int run = 0; run < 3; ++run) {
+    results.clear();
+    const auto start = Clock::now();
+    for (const string& query : queries) {
+      results.push_back(search_server.FindTopDocuments(query));
+    }
+    const double elapsed =
+        chrono::duration<double, micro>(Clock::now() - start).count() /
+        static_cast<double>(queries.size());
+    best = run == 0 ? elapsed : min(best, elapsed);
+  }
+  return best;
+}
+
+static bool IsSameResult(const vector<vector<Document>>& lhs,
+                         const vector<vector<Document>>& rhs) {
+  return equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+               [](const vector<Document>& a, const vector<Document>& b) {
+                 return equal(a.begin(), a.end(), b.begin(), b.end(),
+                              [](const Document& x, const Document& y) {
+                                return x.id == y.id && x.rating == y.rating &&
+                                       abs(x.relevance - y.relevance) <
+                                           REL_TOLERANCE;
+                              });
+               });
+}
+
+int main(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const string flag = argv[i];
+    const int value = atoi(argv[i + 1]);
+    if (flag == "--documents"s) {
+      options.documents = value;
+    } else if (flag == "--topics"s) {
+      options.topics = value;
+    } else if (flag == "--queries"s) {
+      options.queries = value;
+    } else if (flag == "--iterations"s) {
+      options.iterations = value;
+    } else {
+      cerr << "unknown flag "s << flag << endl;
+      return 1;
+    }
+  }
+
+  SearchServer search_server(""s);
+  mt19937 generator(42);
+  vector<int> ids(options.documents);
+  iota(ids.begin(), ids.end(), 0);
+  shuffle(ids.begin(), ids.end(), generator);
+  for (const int id : ids) {
+    const int topic = static_cast<int>(generator() % options.topics);
+    string text;
+    const int word_count = 30 + static_cast<int>(generator() % 70);
+    for (int i = 0; i < word_count; ++i) {
+      text += RandomTopicWord(generator, topic) + " "s;
+    }
+    search_server.AddDocument(id, text, DocumentStatus::ACTUAL,
+                              {static_cast<int>(generator() % 10)});
+  }
+  const vector<string> queries = MakeQueries(options);
+
+  vector<vector<Document>> expected;
+  const auto report = [&](const string& name) {
+    vector<vector<Document>> results;
+    const double latency = MeasureLatency(search_server, queries, results);
+    if (expected.empty()) {
+      expected = results;
+    }
+    cout << name << ": postings "s << search_server.GetEncodedPostingBytes()
+         << " bytes as varint gaps, "s << latency << " us/query"s
+         << (IsSameResult(expected, results) ? ""s : ", RESULTS DIFFER"s)
+         << endl;
+  };
+
+  // Renumbering rebuilds every posting list, which by itself changes the
+  // memory layout; rebuild once in the current order so that all three
+  // measurements start from the same kind of layout
+  search_server.ReorderDocuments(ids);
+  report("insertion order"s);
+
+  vector<int> by_id(search_server.begin(), search_server.end());
+  search_server.ReorderDocuments(by_id);
+  report("id order"s);
+
+  auto start = Clock::now();
+  const vector<int> order =
+      ComputeBisectionOrder(search_server, options.iterations);
+  const double bisection_seconds =
+      chrono::duration<double>(Clock::now() - start).count();
+  start = Clock::now();
+  search_server.ReorderDocuments(order);
+  const double reorder_seconds =
+      chrono::duration<double>(Clock::now() - start).count();
+  report("bisection order"s);
+  cout << "bisection "s << bisection_seconds << " s, renumbering "s
+       << reorder_seconds << " s"s << endl;
+  return 0;
+}
@@ -0,0 +1,213 @@
+// Replays a query log captured by RequestQueue against an index built from
+// a corpus, checks that every result is unchanged and reports throughput
+// and latency.
+//
+//   replay_queries LOG CORPUS [--threads N] [--speed X]
+//                  [--stop-words "and with"] [--capture QUERIES]
+//
+// --speed 1 keeps the recorded arrival times, 10 plays them ten times
+// faster and 0 sends every query as soon as a thread is free. Latency is
+// counted from the scheduled arrival, so time spent waiting behind slow
+// queries shows up in it. With --capture, first writes LOG by sending
+// every line of QUERIES through a RequestQueue.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../ingestion_pipeline.h"
+#include "../latency_stats.h"
+#include "../query_log.h"
+#include "../request_queue.h"
+#include "../search_server.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+// Changed or failed queries printed in full
+constexpr size_t MAX_REPORTED_MISMATCHES = 5ull;
+
+struct Options {
+  string log_path;
+  string corpus_path;
+  size_t threads = 4;
+  double speed = 1.0;
+  string stop_words;
+  string capture_path;
+};
+
+struct ReplayState {
+  atomic<size_t> next_entry = 0;
+  mutex output_mutex;
+  size_t reported = 0;
+};
+
+struct ThreadResult {
+  LatencyStats latency;
+  LatencyStats service;
+  size_t mismatches = 0;
+  size_t errors = 0;
+};
+
+static void Capture(const SearchServer& search_server,
+                    const Options& options) {
+  ifstream in(options.capture_path);
+  RequestQueue request_queue(search_server);
+  request_queue.StartCapture(options.log_path);
+  string query;
+  size_t count = 0;
+  while (getline(in, query)) {
+    try {
+      request_queue.AddFindRequest(query);
+      ++count;
+    } catch (const invalid_argument&) {
+    }
+  }
+  request_queue.StopCapture();
+  cout << "captured "s << count << " queries"s << endl;
+}
+
+static void Report(ReplayState& state, const string& line) {
+  lock_guard guard(state.output_mutex);
+  if (state.reported++ < MAX_REPORTED_MISMATCHES) {
+    cout << line << endl;
+  }
+}
+
+static void ReplayEntries(const SearchServer& search_server,
+                          const vector<const QueryLogEntry*>& entries,
+                          const Options& options, Clock::time_point start,
+                          ReplayState& state, ThreadResult& result) {
+  while (true) {
+    const size_t index = state.next_entry.fetch_add(1);
+    if (index >= entries.size()) {
+      return;
+    }
+    const QueryLogEntry& entry = *entries[index];
+    Clock::time_point due = start;
+    if (options.speed > 0.0) {
+      due += chrono::duration_cast<Clock::duration>(
+          chrono::duration<double, micro>(entry.arrival.count() /
+                                          options.speed));
+      this_thread::sleep_until(due);
+    }
+
+    const auto begin = Clock::now();
+    try {
+      const vector<Document> documents =
+          search_server.FindTopDocuments(entry.raw_query, entry.status);
+      if (HashResult(documents) != entry.result_hash) {
+        ++result.mismatches;
+        Report(state, "changed: "s + entry.raw_query);
+      }
+    } catch (const exception& e) {
+      ++result.errors;
+      Report(state, "failed: "s + entry.raw_query + ": "s + e.what());
+    }
+    const auto end = Clock::now();
+    // Without a schedule there is no arrival to wait behind
+    result.latency.Add(end - (options.speed > 0.0 ? due : begin));
+    result.service.Add(end - begin);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    cerr << "usage: replay_queries LOG CORPUS [--threads N] [--speed X] "s
+            "[--stop-words WORDS] [--capture QUERIES]"s
+         << endl;
+    return 1;
+  }
+  Options options;
+  options.log_path = argv[1];
+  options.corpus_path = argv[2];
+  for (int i = 3; i + 1 < argc; i += 2) {
+    const string flag = argv[i];
+    const string value = argv[i + 1];
+    if (flag == "--threads"s) {
+      options.threads = max(1, atoi(value.c_str()));
+    } else if (flag == "--speed"s) {
+      options.speed = atof(value.c_str());
+    } else if (flag == "--stop-words"s) {
+      options.stop_words = value;
+    } else if (flag == "--capture"s) {
+      options.capture_path = value;
+    } else {
+      cerr << "unknown flag "s << flag << endl;
+      return 1;
+    }
+  }
+
+  try {
+    SearchServer search_server(options.stop_words);
+    const IngestionStats ingestion =
+        IngestCorpus(search_server, options.corpus_path,
+                     DetectCorpusFormat(options.corpus_path));
+    cout << "indexed "s << ingestion.indexed_documents << " documents"s
+         << endl;
+    if (!options.capture_path.empty()) {
+      Capture(search_server, options);
+    }
+
+    const vector<QueryLogEntry> log = ReadQueryLog(options.log_path);
+    vector<const QueryLogEntry*> entries;
+    LatencyStats recorded;
+    for (const QueryLogEntry& entry : log) {
+      if (entry.kind == QueryLogEntry::Kind::STATUS) {
+        entries.push_back(&entry);
+        recorded.Add(entry.latency);
+      }
+    }
+    const auto recorded_span =
+        entries.empty() ? Clock::duration{}
+                        : Clock::duration{entries.back()->arrival};
+    cout << "log: "s << log.size() << " queries, "s
+         << log.size() - entries.size()
+         << " with a predicate cannot be replayed"s << endl;
+
+    vector<ThreadResult> results(options.threads);
+    ReplayState state;
+    const auto start = Clock::now();
+    {
+      vector<thread> threads;
+      for (ThreadResult& result : results) {
+        threads.emplace_back([&, &result = result] {
+          ReplayEntries(search_server, entries, options, start, state,
+                        result);
+        });
+      }
+      for (thread& thread : threads) {
+        thread.join();
+      }
+    }
+    const auto elapsed = Clock::now() - start;
+
+    ThreadResult total;
+    for (const ThreadResult& result : results) {
+      total.latency.Merge(result.latency);
+      total.service.Merge(result.service);
+      total.mismatches += result.mismatches;
+      total.errors += result.errors;
+    }
+    cout << "recorded:  "s;
+    recorded.Report(cout, recorded_span);
+    cout << "replayed:  "s;
+    total.latency.Report(cout, elapsed);
+    cout << "search:    "s;
+    total.service.Report(cout, elapsed);
+    cout << total.mismatches << " changed results, "s << total.errors
+         << " failed queries"s << endl;
+    return total.mismatches == 0 && total.errors == 0 ? 0 : 2;
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+}
@@ -0,0 +1,85 @@
+// Serves a SearchServer over the binary protocol from protocol.h.
+//
+//   search_service [--unix PATH] [--port PORT] [--threads N]
+//                  [--stop-words "and with"] [--timeout-us N]
+//                  [--max-postings N]
+//
+// A FIND over its time or postings limit is answered with the best
+// documents found so far and ResponseCode::PARTIAL.
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <limits>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "../query_service.h"
+#include "../search_server.h"
+#include "../thread_pool.h"
+
+using namespace std;
+
+static QueryService* service_to_stop = nullptr;
+
+static void HandleStopSignal(int /*signal*/) {
+  if (service_to_stop != nullptr) {
+    service_to_stop->Stop();
+  }
+}
+
+int main(int argc, char* argv[]) {
+  string unix_path;
+  int port = -1;
+  size_t thread_count = max(1u, thread::hardware_concurrency());
+  string stop_words;
+  chrono::microseconds query_timeout{0};
+  size_t max_postings = numeric_limits<size_t>::max();
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const string flag = argv[i];
+    if (flag == "--unix"s) {
+      unix_path = argv[i + 1];
+    } else if (flag == "--port"s) {
+      port = atoi(argv[i + 1]);
+    } else if (flag == "--threads"s) {
+      thread_count = static_cast<size_t>(atoi(argv[i + 1]));
+    } else if (flag == "--stop-words"s) {
+      stop_words = argv[i + 1];
+    } else if (flag == "--timeout-us"s) {
+      query_timeout = chrono::microseconds(atoll(argv[i + 1]));
+    } else if (flag == "--max-postings"s) {
+      max_postings = static_cast<size_t>(atoll(argv[i + 1]));
+    } else {
+      cerr << "unknown flag "s << flag << endl;
+      return 1;
+    }
+  }
+  if (unix_path.empty() && port < 0) {
+    unix_path = "/tmp/search_service.sock"s;
+  }
+
+  try {
+    SearchServer search_server(stop_words);
+    ThreadPool pool(thread_count);
+    QueryService service(search_server, pool);
+    service.SetQueryLimits(query_timeout, max_postings);
+    if (!unix_path.empty()) {
+      service.ListenUnix(unix_path);
+      cerr << "listening on "s << unix_path << endl;
+    }
+    if (port >= 0) {
+      service.ListenTcp(static_cast<uint16_t>(port));
+      cerr << "listening on 127.0.0.1:"s << port << endl;
+    }
+    service_to_stop = &service;
+    signal(SIGINT, HandleStopSignal);
+    signal(SIGTERM, HandleStopSignal);
+    service.Run();
+    service_to_stop = nullptr;
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,148 @@
+// Measures what durability costs: ingests the same documents into a plain
+// SearchServer and into a DurableSearchServer from several threads, then
+// times crash recovery from the log against indexing the same documents
+// on one thread. Each time is the best of --runs runs.
+//
+//   wal_benchmark [--dir DIR] [--documents N] [--threads N] [--delay-us N]
+//                 [--runs N]
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../durable_search_server.h"
+#include "../search_server.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+static vector<string> MakeDocuments(int count) {
+  mt19937 generator(1);
+  uniform_int_distribution<int> word(0, 5000);
+  vector<string> documents(count);
+  for (string& text : documents) {
+    for (int i = 0; i < 30; ++i) {
+      text += "w"s + to_string(word(generator)) + ' ';
+    }
+  }
+  return documents;
+}
+
+// Document i goes to thread i % thread_count
+template <typename AddFunction>
+static double TimeIngestion(int document_count, int thread_count,
+                            AddFunction add) {
+  const auto start = Clock::now();
+  vector<thread> threads;
+  for (int t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&, t] {
+      for (int id = t; id < document_count; id += thread_count) {
+        add(id);
+      }
+    });
+  }
+  for (thread& t : threads) {
+    t.join();
+  }
+  return chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+  string directory = "/tmp"s;
+  int document_count = 20000;
+  int thread_count = 8;
+  int commit_delay_us = 0;
+  int runs = 3;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const string flag = argv[i];
+    if (flag == "--dir"s) {
+      directory = argv[i + 1];
+    } else if (flag == "--documents"s) {
+      document_count = stoi(argv[i + 1]);
+    } else if (flag == "--threads"s) {
+      thread_count = stoi(argv[i + 1]);
+    } else if (flag == "--delay-us"s) {
+      commit_delay_us = stoi(argv[i + 1]);
+    } else if (flag == "--runs"s) {
+      runs = max(1, stoi(argv[i + 1]));
+    } else {
+      cerr << "unknown flag "s << flag << endl;
+      return 1;
+    }
+  }
+  const string log_path = directory + "/wal_benchmark.log"s;
+  const string checkpoint_path = directory + "/wal_benchmark.checkpoint"s;
+  const vector<string> documents = MakeDocuments(document_count);
+
+  double plain_seconds = 1e9;
+  double serial_seconds = 1e9;
+  double durable_seconds = 1e9;
+  double recovery_seconds = 1e9;
+  size_t sync_count = 0;
+  size_t recovered_count = 0;
+  for (int run = 0; run < runs; ++run) {
+    unlink(log_path.c_str());
+    unlink(checkpoint_path.c_str());
+
+    SearchServer plain(""s);
+    mutex plain_mutex;
+    plain_seconds = min(
+        plain_seconds, TimeIngestion(document_count, thread_count, [&](int id) {
+          lock_guard guard(plain_mutex);
+          plain.AddDocument(id, documents[id], DocumentStatus::ACTUAL,
+                            {id % 10});
+        }));
+
+    SearchServer serial(""s);
+    serial_seconds =
+        min(serial_seconds, TimeIngestion(document_count, 1, [&](int id) {
+              serial.AddDocument(id, documents[id], DocumentStatus::ACTUAL,
+                                 {id % 10});
+            }));
+
+    {
+      DurableSearchServer durable(""s, log_path, checkpoint_path,
+                                  chrono::microseconds(commit_delay_us));
+      const double seconds =
+          TimeIngestion(document_count, thread_count, [&](int id) {
+            durable.AddDocument(id, documents[id], DocumentStatus::ACTUAL,
+                                {id % 10});
+          });
+      if (seconds < durable_seconds) {
+        durable_seconds = seconds;
+        sync_count = durable.GetSyncCount();
+      }
+    }
+
+    const auto recovery_start = Clock::now();
+    DurableSearchServer recovered(""s, log_path, checkpoint_path);
+    recovery_seconds = min(
+        recovery_seconds,
+        chrono::duration<double>(Clock::now() - recovery_start).count());
+    recovered_count = recovered.GetDocumentCount();
+  }
+
+  cout << "documents: "s << document_count << ", threads: "s << thread_count
+       << endl;
+  cout << "in memory: "s << document_count / plain_seconds << " docs/s"s
+       << endl;
+  cout << "durable:   "s << document_count / durable_seconds << " docs/s, "s
+       << sync_count << " syncs ("s
+       << static_cast<double>(document_count) / max<size_t>(sync_count, 1)
+       << " docs per sync)"s << endl;
+  cout << "slowdown:  "s << durable_seconds / plain_seconds << "x"s << endl;
+  cout << "recovery:  "s << recovered_count << " docs in "s
+       << recovery_seconds << " s, "s << serial_seconds / recovery_seconds
+       << "x the speed of indexing them on one thread"s << endl;
+
+  unlink(log_path.c_str());
+  unlink(checkpoint_path.c_str());
+  return 0;
+}
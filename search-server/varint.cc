@@ -0,0 +1,73 @@
+#include "varint.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+void AppendVarint(std::vector<uint8_t>& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t ReadVarint(const uint8_t*& pos) {
+  uint64_t value = 0;
+  int shift = 0;
+  while (*pos & 0x80) {
+    value |= static_cast<uint64_t>(*pos++ & 0x7f) << shift;
+    shift += 7;
+  }
+  value |= static_cast<uint64_t>(*pos++) << shift;
+  return value;
+}
+
+bool ReadVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value) {
+  const uint8_t* last = pos;
+  while (last != end && (*last & 0x80) != 0) {
+    ++last;
+  }
+  if (last == end || last - pos >= 10) {
+    return false;
+  }
+  value = ReadVarint(pos);
+  return true;
+}
+
+size_t GetVarintSize(uint64_t value) {
+  size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+std::vector<uint8_t> EncodeDeltas(const std::vector<uint32_t>& sorted_values) {
+  std::vector<uint8_t> encoded;
+  encoded.reserve(sorted_values.size());
+  uint32_t previous = 0;
+  for (const uint32_t value : sorted_values) {
+    AppendVarint(encoded, value - previous);
+    previous = value;
+  }
+  encoded.shrink_to_fit();
+  return encoded;
+}
+
+std::vector<uint32_t> DecodeDeltas(const std::vector<uint8_t>& encoded) {
+  return DecodeDeltas(encoded.data(), encoded.data() + encoded.size());
+}
+
+std::vector<uint32_t> DecodeDeltas(const uint8_t* begin, const uint8_t* end) {
+  std::vector<uint32_t> values;
+  values.reserve(end - begin);
+  const uint8_t* pos = begin;
+  uint32_t value = 0;
+  while (pos != end) {
+    value += static_cast<uint32_t>(ReadVarint(pos));
+    values.push_back(value);
+  }
+  return values;
+}
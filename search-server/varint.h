@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// LEB128: 7 bits per byte, high bit marks continuation
+void AppendVarint(std::vector<uint8_t>& out, uint64_t value);
+
+// Advances pos past the decoded value
+uint64_t ReadVarint(const uint8_t*& pos);
+
+// For untrusted input: fails, leaving pos as is, if the value does not
+// end before end or is longer than 10 bytes
+bool ReadVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value);
+
+// Bytes AppendVarint would write
+size_t GetVarintSize(uint64_t value);
+
+// Sorted values stored as gaps from the previous one
+std::vector<uint8_t> EncodeDeltas(const std::vector<uint32_t>& sorted_values);
+std::vector<uint32_t> DecodeDeltas(const std::vector<uint8_t>& encoded);
+std::vector<uint32_t> DecodeDeltas(const uint8_t* begin, const uint8_t* end);
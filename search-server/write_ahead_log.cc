@@ -0,0 +1,288 @@
+#include "write_ahead_log.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "varint.h"
+
+constexpr size_t RECORD_HEADER_SIZE = 8ull;
+
+static uint32_t Crc32(const char* data, size_t size) {
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> result{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ (crc & 1 ? 0xedb88320u : 0u);
+      }
+      result[i] = crc;
+    }
+    return result;
+  }();
+  uint32_t crc = 0xffffffffu;
+  for (size_t i = 0; i < size; ++i) {
+    crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+  }
+  return crc ^ 0xffffffffu;
+}
+
+static void AppendUint32(std::string& out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+static uint32_t ReadUint32(const char* data) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value |= static_cast<uint32_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+  }
+  return value;
+}
+
+// Ratings may be negative
+static uint64_t ZigZag(int value) {
+  return (static_cast<uint64_t>(static_cast<int64_t>(value)) << 1) ^
+         static_cast<uint64_t>(static_cast<int64_t>(value) >> 63);
+}
+
+static int UnZigZag(uint64_t value) {
+  return static_cast<int>(static_cast<int64_t>(value >> 1) ^
+                          -static_cast<int64_t>(value & 1));
+}
+
+void AppendLogRecord(std::string& out, const LogRecord& record) {
+  std::vector<uint8_t> payload;
+  payload.push_back(static_cast<uint8_t>(record.type));
+  AppendVarint(payload, ZigZag(record.document_id));
+  if (record.type == LogRecord::Type::ADD) {
+    payload.push_back(static_cast<uint8_t>(record.status));
+    AppendVarint(payload, record.ratings.size());
+    for (const int rating : record.ratings) {
+      AppendVarint(payload, ZigZag(rating));
+    }
+    AppendVarint(payload, record.text.size());
+    payload.insert(payload.end(), record.text.cbegin(), record.text.cend());
+  }
+  const auto* data = reinterpret_cast<const char*>(payload.data());
+  AppendUint32(out, static_cast<uint32_t>(payload.size()));
+  AppendUint32(out, Crc32(data, payload.size()));
+  out.append(data, payload.size());
+}
+
+// A checksum can collide, so every field is checked against size
+static bool ParseLogRecord(const char* data, size_t size, LogRecord& record) {
+  const auto* pos = reinterpret_cast<const uint8_t*>(data);
+  const auto* const end = pos + size;
+  const auto can_read = [&pos, end](uint64_t bytes) {
+    return static_cast<uint64_t>(end - pos) >= bytes;
+  };
+  if (!can_read(1)) {
+    return false;
+  }
+  record.type = static_cast<LogRecord::Type>(*pos++);
+  if (record.type != LogRecord::Type::ADD &&
+      record.type != LogRecord::Type::REMOVE) {
+    return false;
+  }
+  uint64_t value = 0;
+  if (!ReadVarint(pos, end, value)) {
+    return false;
+  }
+  record.document_id = UnZigZag(value);
+  if (record.type == LogRecord::Type::REMOVE) {
+    return pos == end;
+  }
+  if (!can_read(1) || *pos > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+    return false;
+  }
+  record.status = static_cast<DocumentStatus>(*pos++);
+  uint64_t rating_count = 0;
+  // Every rating takes at least one byte
+  if (!ReadVarint(pos, end, rating_count) || !can_read(rating_count)) {
+    return false;
+  }
+  record.ratings.clear();
+  record.ratings.reserve(rating_count);
+  for (uint64_t i = 0; i < rating_count; ++i) {
+    if (!ReadVarint(pos, end, value)) {
+      return false;
+    }
+    record.ratings.push_back(UnZigZag(value));
+  }
+  uint64_t text_size = 0;
+  if (!ReadVarint(pos, end, text_size) || !can_read(text_size)) {
+    return false;
+  }
+  record.text.assign(reinterpret_cast<const char*>(pos), text_size);
+  pos += text_size;
+  return pos == end;
+}
+
+std::vector<LogRecord> WriteAheadLog::ReadRecords(const std::string& path,
+                                                  size_t* valid_size) {
+  std::ifstream input(path, std::ios::binary);
+  const std::string data((std::istreambuf_iterator<char>(input)),
+                         std::istreambuf_iterator<char>());
+  std::vector<LogRecord> records;
+  size_t pos = 0;
+  while (data.size() - pos >= RECORD_HEADER_SIZE) {
+    const uint32_t payload_size = ReadUint32(data.data() + pos);
+    const uint32_t crc = ReadUint32(data.data() + pos + 4);
+    if (data.size() - pos - RECORD_HEADER_SIZE < payload_size) {
+      break;
+    }
+    const char* payload = data.data() + pos + RECORD_HEADER_SIZE;
+    LogRecord record;
+    if (Crc32(payload, payload_size) != crc ||
+        !ParseLogRecord(payload, payload_size, record)) {
+      break;
+    }
+    records.push_back(std::move(record));
+    pos += RECORD_HEADER_SIZE + payload_size;
+  }
+  if (valid_size != nullptr) {
+    *valid_size = pos;
+  }
+  return records;
+}
+
+WriteAheadLog::WriteAheadLog(const std::string& path,
+                             std::chrono::microseconds commit_delay)
+    : path_(path), commit_delay_(commit_delay) {
+  size_t valid_size = 0;
+  recovered_records_ = ReadRecords(path_, &valid_size);
+  fd_ = open(path_.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    throw std::system_error(errno, std::generic_category(), "open");
+  }
+  if (ftruncate(fd_, static_cast<off_t>(valid_size)) < 0 ||
+      lseek(fd_, static_cast<off_t>(valid_size), SEEK_SET) < 0) {
+    const int error = errno;
+    close(fd_);
+    throw std::system_error(error, std::generic_category(), "ftruncate");
+  }
+  flusher_ = std::thread([this] { FlusherLoop(); });
+}
+
+WriteAheadLog::~WriteAheadLog() {
+  {
+    std::lock_guard guard(mutex_);
+    is_stopping_ = true;
+  }
+  has_data_.notify_one();
+  flusher_.join();
+  close(fd_);
+}
+
+std::vector<LogRecord> WriteAheadLog::TakeRecoveredRecords() {
+  return std::move(recovered_records_);
+}
+
+uint64_t WriteAheadLog::Append(const LogRecord& record) {
+  std::string encoded;
+  AppendLogRecord(encoded, record);
+  std::lock_guard guard(mutex_);
+  buffer_ += encoded;
+  has_data_.notify_one();
+  return ++appended_;
+}
+
+void WriteAheadLog::WaitDurable(uint64_t sequence_number) {
+  std::unique_lock lock(mutex_);
+  ++waiting_count_;
+  has_data_.notify_one();
+  is_durable_.wait(lock, [this, sequence_number] {
+    return durable_ >= sequence_number || error_;
+  });
+  --waiting_count_;
+  if (error_) {
+    std::rethrow_exception(error_);
+  }
+}
+
+void WriteAheadLog::Truncate() {
+  std::unique_lock lock(mutex_);
+  is_durable_.wait(lock, [this] {
+    return (buffer_.empty() && durable_ == appended_) || error_;
+  });
+  // Records lost by a failed write may not be in the caller's checkpoint
+  if (error_) {
+    std::rethrow_exception(error_);
+  }
+  if (ftruncate(fd_, 0) < 0 || lseek(fd_, 0, SEEK_SET) < 0 ||
+      fdatasync(fd_) < 0) {
+    throw std::system_error(errno, std::generic_category(), "ftruncate");
+  }
+}
+
+size_t WriteAheadLog::GetSyncCount() const {
+  std::lock_guard guard(mutex_);
+  return sync_count_;
+}
+
+void WriteAheadLog::FlusherLoop() {
+  std::unique_lock lock(mutex_);
+  while (true) {
+    has_data_.wait(lock, [this] { return is_stopping_ || !buffer_.empty(); });
+    if (buffer_.empty()) {
+      return;
+    }
+    // Only worth waiting when more than one writer shares this sync
+    if (commit_delay_.count() > 0 && waiting_count_ > 1 && !is_stopping_) {
+      const uint64_t pending = appended_ - durable_;
+      has_data_.wait_for(lock, commit_delay_, [this, pending] {
+        return is_stopping_ || appended_ - durable_ > pending * 2;
+      });
+    }
+    // Everything appended while the previous sync ran goes out together
+    std::string data;
+    data.swap(buffer_);
+    const uint64_t target = appended_;
+    lock.unlock();
+    std::exception_ptr error;
+    try {
+      WriteAndSync(data);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    lock.lock();
+    if (error) {
+      error_ = error;
+    } else {
+      durable_ = target;
+      ++sync_count_;
+    }
+    is_durable_.notify_all();
+  }
+}
+
+void WriteAheadLog::WriteAndSync(const std::string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    const ssize_t size = write(fd_, data.data() + written, data.size() - written);
+    if (size < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(), "write");
+    }
+    written += static_cast<size_t>(size);
+  }
+  if (fdatasync(fd_) < 0) {
+    throw std::system_error(errno, std::generic_category(), "fdatasync");
+  }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+
+struct LogRecord {
+  enum class Type : uint8_t {
+    ADD = 1,
+    REMOVE = 2,
+  };
+
+  Type type = Type::ADD;
+  int document_id = 0;
+  DocumentStatus status = DocumentStatus::ACTUAL;
+  std::vector<int> ratings;
+  std::string text;
+};
+
+// On disk every record is [uint32 payload size][uint32 crc32][payload]
+void AppendLogRecord(std::string& out, const LogRecord& record);
+
+// Append-only log with group commit. Append only buffers a record; a
+// background thread writes everything buffered so far with one fdatasync,
+// so concurrent writers waiting in WaitDurable share the cost of a sync.
+// With a commit_delay, a sync that other writers are already waiting on is
+// held back up to that long to collect more records.
+class WriteAheadLog {
+ public:
+  // Reads the records already in the file and cuts off a torn or corrupt
+  // tail left by a crash, so new records go right after the valid ones
+  explicit WriteAheadLog(
+      const std::string& path,
+      std::chrono::microseconds commit_delay = std::chrono::microseconds{0});
+  ~WriteAheadLog();
+
+  WriteAheadLog(const WriteAheadLog&) = delete;
+  WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+  std::vector<LogRecord> TakeRecoveredRecords();
+
+  // Returns a sequence number to wait for
+  uint64_t Append(const LogRecord& record);
+  // Throws std::system_error if the log could not be written
+  void WaitDurable(uint64_t sequence_number);
+
+  // Drops every record; the caller must have made them redundant. Throws
+  // like WaitDurable if the log could not be written.
+  void Truncate();
+
+  size_t GetSyncCount() const;
+
+  static std::vector<LogRecord> ReadRecords(const std::string& path,
+                                            size_t* valid_size = nullptr);
+
+ private:
+  const std::string path_;
+  const std::chrono::microseconds commit_delay_;
+  int fd_ = -1;
+  std::vector<LogRecord> recovered_records_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable has_data_;
+  std::condition_variable is_durable_;
+  std::string buffer_;
+  uint64_t appended_ = 0;
+  uint64_t durable_ = 0;
+  size_t waiting_count_ = 0;
+  size_t sync_count_ = 0;
+  bool is_stopping_ = false;
+  std::exception_ptr error_;
+  std::thread flusher_;
+
+  void FlusherLoop();
+  void WriteAndSync(const std::string& data);
+};